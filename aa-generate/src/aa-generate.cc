@@ -0,0 +1,195 @@
+#include "aa-generate.h"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+  enum class rule_kind
+  {
+    file,
+    link,
+    abstraction,
+    hat,
+    subprofile,
+    conditional
+  };
+
+  // Each conditional block uses one of these boolean variables
+  constexpr size_t boolean_count = 16;
+
+  constexpr const char *directories[] = { "usr/lib", "usr/share", "etc", "var/lib", "opt", "srv", "tmp", "run" };
+  constexpr const char *modes[]       = { "r", "rw", "mr", "rwk", "rl", "a", "rm", "w" };
+  constexpr const char *exec_modes[]  = { "", "r", "m", "mr" };
+  constexpr const char *transitions[] = { "", "ix", "Px", "Cx" };
+  constexpr const char *globs[]       = { "", "", "/*", "/**", "*", ".conf" };
+  constexpr const char *abstractions[] = { "base", "nameservice", "user-tmp", "fonts", "audio", "dbus-session" };
+} // namespace
+
+AppArmorGenerate::random::random(uint64_t seed)
+  : state{seed}
+{ }
+
+uint64_t AppArmorGenerate::random::next()
+{
+  state += 0x9E3779B97F4A7C15ULL;
+
+  uint64_t value = state;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+size_t AppArmorGenerate::random::below(size_t bound)
+{
+  return static_cast<size_t>(next() % bound);
+}
+
+std::string AppArmorGenerate::file_path(const options &opts, random &rng)
+{
+  std::stringstream path;
+
+  // Some paths start with a variable, if any were declared
+  if(opts.variables > 0 && rng.below(4) == 0) {
+    path << "@{GEN_VAR_" << rng.below(opts.variables) << "}";
+  } else {
+    path << '/' << directories[rng.below(std::size(directories))];
+  }
+
+  auto depth = 1 + rng.below(4);
+  for(size_t i = 0; i < depth; i++) {
+    path << "/gen" << rng.below(1000);
+  }
+
+  path << globs[rng.below(std::size(globs))];
+  return path.str();
+}
+
+std::string AppArmorGenerate::file_mode(const std::string &path, random &rng)
+{
+  // A path may only have one exec transition, so it comes from a hash of the path rather than from 'rng'
+  // Only paths without a glob can be executed, since a glob could match a path with another transition
+  const char *transition = "";
+  if(path.find('*') == std::string::npos) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for(char ch : path) {
+      hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001B3ULL;
+    }
+
+    transition = transitions[hash % std::size(transitions)];
+  }
+
+  if(*transition == '\0') {
+    return modes[rng.below(std::size(modes))];
+  }
+
+  return std::string(exec_modes[rng.below(std::size(exec_modes))]) + transition;
+}
+
+void AppArmorGenerate::write_nested_rules(const options &opts, random &rng, std::ostream &output, const std::string &indent)
+{
+  for(size_t i = 0; i < opts.nested_rules; i++) {
+    auto path = file_path(opts, rng);
+    output << indent << path << ' ' << file_mode(path, rng) << ",\n";
+  }
+}
+
+void AppArmorGenerate::write_profile(const options &opts, random &rng, std::ostream &output, size_t index)
+{
+  // Decide on every rule first, then shuffle them so that the kinds are interleaved
+  std::vector<rule_kind> kinds;
+  kinds.insert(kinds.end(), opts.file_rules,   rule_kind::file);
+  kinds.insert(kinds.end(), opts.link_rules,   rule_kind::link);
+  kinds.insert(kinds.end(), opts.abstractions, rule_kind::abstraction);
+  kinds.insert(kinds.end(), opts.hats,         rule_kind::hat);
+  kinds.insert(kinds.end(), opts.subprofiles,  rule_kind::subprofile);
+  kinds.insert(kinds.end(), opts.conditionals, rule_kind::conditional);
+
+  for(size_t i = kinds.size(); i > 1; i--) {
+    std::swap(kinds[i - 1], kinds[rng.below(i)]);
+  }
+
+  output << "/usr/bin/generated-" << index << " {\n";
+
+  size_t hats = 0;
+  size_t subprofiles = 0;
+  size_t links = 0;
+  size_t conditionals = 0;
+
+  for(const auto &kind : kinds) {
+    switch(kind) {
+      case rule_kind::file: {
+        auto path = file_path(opts, rng);
+        output << "  " << path << ' ' << file_mode(path, rng) << ",\n";
+        break;
+      }
+
+      case rule_kind::link:
+        output << "  link /tmp/generated-" << index << "/link" << links << " -> " << file_path(opts, rng) << ",\n";
+        links++;
+        break;
+
+      case rule_kind::abstraction:
+        output << "  #include <abstractions/" << abstractions[rng.below(std::size(abstractions))] << ">\n";
+        break;
+
+      case rule_kind::hat:
+        output << "\n  ^hat" << hats << " {\n";
+        write_nested_rules(opts, rng, output, "    ");
+        output << "  }\n";
+        hats++;
+        break;
+
+      case rule_kind::subprofile:
+        output << "\n  profile sub" << subprofiles << " {\n";
+        write_nested_rules(opts, rng, output, "    ");
+        output << "  }\n";
+        subprofiles++;
+        break;
+
+      case rule_kind::conditional:
+        output << "  if ${GEN_BOOL_" << (conditionals % boolean_count) << "} {\n";
+        write_nested_rules(opts, rng, output, "    ");
+        output << "  }\n";
+        conditionals++;
+        break;
+    }
+  }
+
+  output << "}\n";
+}
+
+void AppArmorGenerate::generate(const options &opts, std::ostream &output)
+{
+  random rng(opts.seed);
+
+  output << "# Generated by aa-generate (seed " << opts.seed << ")\n";
+
+  if(opts.abstractions > 0) {
+    output << "#include <tunables/global>\n";
+  }
+
+  for(size_t i = 0; i < opts.variables; i++) {
+    output << "@{GEN_VAR_" << i << "} = /usr/lib/generated/" << i << " /opt/generated/" << i << '\n';
+  }
+
+  if(opts.conditionals > 0) {
+    for(size_t i = 0; i < std::min(opts.conditionals, boolean_count); i++) {
+      output << "${GEN_BOOL_" << i << "} = " << (rng.below(2) == 0 ? "true" : "false") << '\n';
+    }
+  }
+
+  for(size_t i = 0; i < opts.profiles; i++) {
+    output << '\n';
+    write_profile(opts, rng, output, i);
+  }
+}
+
+std::string AppArmorGenerate::generate(const options &opts)
+{
+  std::stringstream output;
+  generate(opts, output);
+  return output.str();
+}
@@ -0,0 +1,64 @@
+#ifndef SRC_AA_GENERATE
+#define SRC_AA_GENERATE
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * Writes large, valid AppArmor profiles for scaling tests and benchmarks.
+ * The output only depends on the options (including the seed), so the same options always produce the same profile.
+ **/
+class AppArmorGenerate
+{
+public:
+  struct options
+  {
+    uint64_t seed = 0;
+
+    // Number of top-level profiles
+    size_t profiles = 1;
+
+    // Number of rules of each kind in every top-level profile
+    size_t file_rules   = 100;
+    size_t link_rules   = 0;
+    size_t abstractions = 0;
+    size_t hats         = 0;
+    size_t subprofiles  = 0;
+    size_t conditionals = 0;
+
+    // Number of file rules in each hat, subprofile and conditional block
+    size_t nested_rules = 3;
+
+    // Number of variables declared before the profiles, which are used by some file rules
+    size_t variables = 0;
+  };
+
+  static std::string generate(const options &opts);
+  static void generate(const options &opts, std::ostream &output);
+
+protected:
+  // Small, portable pseudo-random number generator (splitmix64)
+  // Unlike the standard distributions, its output is the same with every compiler and standard library
+  class random
+  {
+  public:
+    explicit random(uint64_t seed);
+
+    uint64_t next();
+
+    // Returns a number in [0, bound)
+    size_t below(size_t bound);
+
+  private:
+    uint64_t state;
+  };
+
+  static void write_profile(const options &opts, random &rng, std::ostream &output, size_t index);
+  static void write_nested_rules(const options &opts, random &rng, std::ostream &output, const std::string &indent);
+  static std::string file_path(const options &opts, random &rng);
+  static std::string file_mode(const std::string &path, random &rng);
+};
+
+#endif // SRC_AA_GENERATE
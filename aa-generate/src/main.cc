@@ -0,0 +1,93 @@
+#include "aa-generate.h"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+void print_usage()
+{
+  std::cout << "Writes large, valid AppArmor profiles for scaling tests (used internally by the AppAnvil Project)" << std::endl << std::endl;
+  std::cout << "Usage: aa-generate [options] [output file]" << std::endl << std::endl;
+  std::cout << "Options (each takes a number):" << std::endl;
+  std::cout << "  --seed           seed for the generated paths and ordering (default 0)" << std::endl;
+  std::cout << "  --profiles       number of top-level profiles (default 1)" << std::endl;
+  std::cout << "  --file-rules     file rules in each profile (default 100)" << std::endl;
+  std::cout << "  --link-rules     link rules in each profile" << std::endl;
+  std::cout << "  --abstractions   abstractions included by each profile" << std::endl;
+  std::cout << "  --hats           hats in each profile" << std::endl;
+  std::cout << "  --subprofiles    subprofiles in each profile" << std::endl;
+  std::cout << "  --conditionals   conditional blocks in each profile" << std::endl;
+  std::cout << "  --nested-rules   file rules in each hat, subprofile and conditional block (default 3)" << std::endl;
+  std::cout << "  --variables      variables declared before the profiles" << std::endl << std::endl;
+  std::cout << "The profile is written to standard output if no output file is given." << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  AppArmorGenerate::options opts;
+  std::map<std::string, size_t *> numeric_options = {
+    { "--profiles",     &opts.profiles },
+    { "--file-rules",   &opts.file_rules },
+    { "--link-rules",   &opts.link_rules },
+    { "--abstractions", &opts.abstractions },
+    { "--hats",         &opts.hats },
+    { "--subprofiles",  &opts.subprofiles },
+    { "--conditionals", &opts.conditionals },
+    { "--nested-rules", &opts.nested_rules },
+    { "--variables",    &opts.variables },
+  };
+
+  std::string output_file;
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  for(int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+
+    if(arg == "-h" || arg == "--help") {
+      print_usage();
+      return 0;
+    }
+
+    if(arg == "--seed" && i + 1 < argc) {
+      try {
+        opts.seed = std::stoull(argv[++i]);
+      } catch(const std::exception &) {
+        std::cerr << "Expected a number after '" << arg << "'" << std::endl;
+        return 1;
+      }
+      continue;
+    }
+
+    auto option = numeric_options.find(arg);
+    if(option != numeric_options.end() && i + 1 < argc) {
+      try {
+        *option->second = std::stoull(argv[++i]);
+      } catch(const std::exception &) {
+        std::cerr << "Expected a number after '" << arg << "'" << std::endl;
+        return 1;
+      }
+    } else if(option == numeric_options.end() && output_file.empty() && arg.rfind("--", 0) != 0) {
+      output_file = arg;
+    } else {
+      print_usage();
+      return 1;
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  if(output_file.empty()) {
+    AppArmorGenerate::generate(opts, std::cout);
+    return 0;
+  }
+
+  std::ofstream file(output_file);
+  if(!file.is_open()) {
+    std::cerr << "Could not open '" << output_file << "' for writing" << std::endl;
+    return 2;
+  }
+
+  AppArmorGenerate::generate(opts, file);
+  return 0;
+}
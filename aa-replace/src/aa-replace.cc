@@ -1,9 +1,17 @@
 #include "aa-replace.h"
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
 #include <cstdlib>
 #include <glibmm/spawn.h>
 #include <iostream>
-#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
 
 AppArmorReplace::results AppArmorReplace::call_command(const std::vector<std::string> &command)
 {
@@ -40,15 +48,77 @@ int AppArmorReplace::call_command_wrapper(const std::vector<std::string> &comman
 // Static protected methods
 int AppArmorReplace::apply_profile(AppArmorReplace *caller, const std::string &filename, const std::string &profile_data)
 {
-  std::ofstream file;
-  file.open(filename);
+  std::istringstream stream(profile_data);
+  return replace_file(caller, filename, stream, profile_data.size());
+}
+
+int AppArmorReplace::apply_profile(AppArmorReplace *caller, const std::string &filename, std::istream &profile_data)
+{
+  // The data starts with its size on a line of its own, so that input which ends early is never applied
+  std::string header;
+  if (!std::getline(profile_data, header)) {
+    return 2;
+  }
+
+  uint64_t size = 0;
+  auto [end, error] = std::from_chars(header.data(), header.data() + header.size(), size);
+  if (error != std::errc() || end != header.data() + header.size()) {
+    return 2;
+  }
+
+  return replace_file(caller, filename, profile_data, size);
+}
 
-  if (!file.is_open()) {
+int AppArmorReplace::replace_file(AppArmorReplace *caller, const std::string &filename, std::istream &profile_data, uint64_t size)
+{
+  // The data is written to a temporary file in the same directory, which replaces the profile only once all of it arrived
+  // That way, the profile is never left truncated or half written
+  std::string temp_name = filename + ".XXXXXX";
+  int fd = mkstemp(temp_name.data());
+  if (fd < 0) {
     return 2;
   }
 
-  file << profile_data;
-  file.close();
+  // Keep the permissions of the profile being replaced, rather than the 0600 of a new temporary file
+  struct stat target_stat {};
+  mode_t mode = (stat(filename.c_str(), &target_stat) == 0) ? (target_stat.st_mode & 07777) : 0644;
+  bool success = fchmod(fd, mode) == 0;
+
+  // Copy the data in blocks, so a large profile is never held in memory at once
+  std::array<char, 65536> buffer{};
+  uint64_t remaining = size;
+  while (success && remaining > 0) {
+    auto block = static_cast<std::streamsize>(std::min<uint64_t>(remaining, buffer.size()));
+    profile_data.read(buffer.data(), block);
+
+    auto count = profile_data.gcount();
+    if (count <= 0) {
+      success = false;
+      break;
+    }
+
+    remaining -= static_cast<uint64_t>(count);
+    std::string_view pending(buffer.data(), static_cast<size_t>(count));
+    while (!pending.empty()) {
+      auto written = write(fd, pending.data(), pending.size());
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      if (written <= 0) {
+        success = false;
+        break;
+      }
+
+      pending.remove_prefix(static_cast<size_t>(written));
+    }
+  }
+
+  success = success && fsync(fd) == 0;
+  success = (close(fd) == 0) && success;
+  if (!success || rename(temp_name.c_str(), filename.c_str()) != 0) {
+    unlink(temp_name.c_str());
+    return 2;
+  }
 
   std::vector<std::string> command = { "apparmor_parser", "-r", filename };
   return caller->call_command_wrapper(command);
@@ -60,3 +130,9 @@ int AppArmorReplace::apply_profile(const std::string &filename, const std::strin
   AppArmorReplace caller;
   return apply_profile(&caller, filename, profile_data);
 }
+
+int AppArmorReplace::apply_profile(const std::string &filename, std::istream &profile_data)
+{
+  AppArmorReplace caller;
+  return apply_profile(&caller, filename, profile_data);
+}
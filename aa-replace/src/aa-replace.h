@@ -1,6 +1,8 @@
 #ifndef SRC_AA_LOADER
 #define SRC_AA_LOADER
 
+#include <cstdint>
+#include <istream>
 #include <string>
 #include <vector>
 
@@ -24,6 +26,10 @@ public:
 
   static int apply_profile(const std::string &filename, const std::string &profile_data);
 
+  // Copies 'profile_data' into the file as it is read, such as from standard input, instead of holding the whole profile in memory
+  // The data starts with its size in bytes on a line of its own, and the file is only replaced once that many bytes were read
+  static int apply_profile(const std::string &filename, std::istream &profile_data);
+
 protected:
   struct results
   {
@@ -38,6 +44,10 @@ protected:
 
   // Dependency Injection: For unit testing
   static int apply_profile(AppArmorReplace *caller, const std::string &filename, const std::string &profile_data);
+  static int apply_profile(AppArmorReplace *caller, const std::string &filename, std::istream &profile_data);
+
+  // Writes 'size' bytes of 'profile_data' to a temporary file, then renames it over 'filename' and loads it
+  static int replace_file(AppArmorReplace *caller, const std::string &filename, std::istream &profile_data, uint64_t size);
 };
 
 #endif // COMMAND_CALLER_H
@@ -6,12 +6,22 @@ void print_usage()
 {
   std::cout << "A simple wrapper for 'apparmor_parser -r' (used internally by the AppAnvil Project)" << std::endl;
   std::cout << "This tool is not intended for direct use by the end-user" << std::endl << std::endl;
-  std::cout << "Usage: aa-replace [filename] [filedata]" << std::endl << std::endl;
+  std::cout << "Usage: aa-replace [filename] < [size] [newline] [filedata]" << std::endl;
+  std::cout << "       aa-replace [filename] [filedata]" << std::endl << std::endl;
+  std::cout << "Reading the data from standard input is preferred, since an argument is limited to 128 KiB" << std::endl << std::endl;
 }
 
 int main(int argc, char **argv)
 {
   // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  if (argc == 2) {
+    std::string arg_1(argv[1]);
+
+    // Standard input is only read through std::cin, so it does not need to be kept in sync with C stdio
+    std::ios::sync_with_stdio(false);
+    return AppArmorReplace::apply_profile(arg_1, std::cin);
+  }
+
   if (argc == 3) {
     std::string arg_1(argv[1]);
     std::string arg_2(argv[2]);
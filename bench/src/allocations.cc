@@ -0,0 +1,48 @@
+#include "allocations.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace {
+  std::atomic<size_t> allocation_count{0};
+  std::atomic<size_t> allocated_bytes{0};
+} // namespace
+
+size_t Allocations::count()
+{
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+size_t Allocations::live_bytes()
+{
+  return allocated_bytes.load(std::memory_order_relaxed);
+}
+
+// Replace the global allocation functions, so that every allocation in the benchmarks (and the library) is counted
+// The array forms and the sized deletes use these by default
+void *operator new(size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  void *ptr = std::malloc(size == 0 ? 1 : size); // NOLINT(cppcoreguidelines-no-malloc)
+  if(ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  allocated_bytes.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+  allocated_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+  std::free(ptr); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void operator delete(void *ptr, size_t /*size*/) noexcept
+{
+  allocated_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+  std::free(ptr); // NOLINT(cppcoreguidelines-no-malloc)
+}
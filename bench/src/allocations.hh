@@ -0,0 +1,15 @@
+#ifndef ALLOCATIONS_HH
+#define ALLOCATIONS_HH
+
+#include <cstddef>
+
+// Counts calls to the global operator new, so benchmarks can report allocations (and memory) per rule
+namespace Allocations {
+  // Returns the number of allocations made by the program so far
+  size_t count();
+
+  // Returns the number of bytes currently allocated by the program, including what malloc rounds each allocation up to
+  size_t live_bytes();
+} // namespace Allocations
+
+#endif // ALLOCATIONS_HH
@@ -0,0 +1,310 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "aa-generate.h"
+#include "allocations.hh"
+#include "apparmor_parser.hh"
+#include "corpus.hh"
+#include "synthetic.hh"
+
+using namespace AppArmor::Literals;
+
+namespace {
+  // Writes a synthetic profile to a temporary file, which is removed when this goes out of scope
+  class TempProfile {
+    public:
+      explicit TempProfile(size_t rule_count)
+        : TempProfile(Synthetic::make_profile(rule_count))
+      {   }
+
+      explicit TempProfile(std::string profile)
+        : path{std::filesystem::temp_directory_path() / ("appanvil-bench-" + std::to_string(std::hash<std::string>{}(profile)) + ".sd")},
+          contents{std::move(profile)}
+      {
+        std::ofstream stream(path);
+        stream << contents;
+      }
+
+      TempProfile(const TempProfile &) = delete;
+      TempProfile &operator=(const TempProfile &) = delete;
+
+      ~TempProfile()
+      {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+      }
+
+      std::string getPath() const { return path.string(); }
+      size_t size() const { return contents.size(); }
+
+    private:
+      std::filesystem::path path;
+      std::string contents;
+  };
+
+  // Returns an iterator to the file rule in the middle of a profile
+  auto middle_rule(std::vector<AppArmor::FileRule> &rules)
+  {
+    return std::next(rules.begin(), static_cast<long>(rules.size() / 2));
+  }
+
+  // Reads and parses a profile through AppArmor::Parser
+  void BM_ParserLoad(benchmark::State &state)
+  {
+    const auto rule_count = state.range(0);
+    TempProfile profile(rule_count);
+
+    const auto allocations = Allocations::count();
+    for(auto _ : state) {
+      AppArmor::Parser parser(profile.getPath());
+      benchmark::DoNotOptimize(parser);
+    }
+
+    const auto rules = static_cast<double>(state.iterations() * rule_count);
+    state.counters["allocs_per_rule"] = static_cast<double>(Allocations::count() - allocations) / rules;
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * profile.size()));
+    state.SetItemsProcessed(state.iterations() * rule_count);
+    state.SetComplexityN(rule_count);
+  }
+
+  // Memory held by a parsed profile (not counting its text), per rule
+  // The size of the rule classes is reported too, since most of a rule's memory is its node
+  void BM_RuleMemory(benchmark::State &state)
+  {
+    const auto rule_count = state.range(0);
+    TempProfile profile(rule_count);
+
+    size_t bytes = 0;
+    for(auto _ : state) {
+      const auto before = Allocations::live_bytes();
+      AppArmor::Parser parser(profile.getPath());
+      bytes = Allocations::live_bytes() - before - profile.size();
+      benchmark::DoNotOptimize(parser);
+    }
+
+    state.counters["bytes_per_rule"]  = static_cast<double>(bytes) / static_cast<double>(rule_count);
+    state.counters["sizeof_RuleNode"] = sizeof(AppArmor::RuleNode);
+    state.counters["sizeof_FileRule"] = sizeof(AppArmor::FileRule);
+    state.counters["sizeof_Profile"]  = sizeof(AppArmor::Profile);
+  }
+
+  // Reads every file rule of a profile, like a read-only consumer listing rules
+  void BM_GetProfileList(benchmark::State &state)
+  {
+    const auto rule_count = state.range(0);
+    TempProfile profile(rule_count);
+    AppArmor::Parser parser(profile.getPath());
+
+    for(auto _ : state) {
+      size_t length = 0;
+      for(const auto &prof : parser.getProfileList()) {
+        for(const auto &rule : prof.getFileRules()) {
+          length += rule.getFilename().size();
+        }
+      }
+      benchmark::DoNotOptimize(length);
+    }
+
+    state.SetItemsProcessed(state.iterations() * rule_count);
+    state.SetComplexityN(rule_count);
+  }
+
+  // Latency of adding one rule to a profile of a given size
+  // The profile is reverted between iterations, outside of the timed region
+  void BM_AddRule(benchmark::State &state)
+  {
+    const auto rule_count = state.range(0);
+    TempProfile profile(rule_count);
+    AppArmor::Parser parser(profile.getPath());
+    const AppArmor::FileRule new_rule("/usr/share/added/**", "r"_mode);
+
+    for(auto _ : state) {
+      state.PauseTiming();
+      parser.cancelChanges();
+      auto prof = parser.getProfileList().front();
+      state.ResumeTiming();
+
+      parser.addRule(prof, new_rule);
+    }
+
+    state.SetComplexityN(rule_count);
+  }
+
+  // Latency of removing the middle rule from a profile of a given size
+  void BM_RemoveRule(benchmark::State &state)
+  {
+    const auto rule_count = state.range(0);
+    TempProfile profile(rule_count);
+    AppArmor::Parser parser(profile.getPath());
+
+    for(auto _ : state) {
+      state.PauseTiming();
+      parser.cancelChanges();
+      auto prof  = parser.getProfileList().front();
+      auto rules = prof.getFileRules();
+      auto rule  = middle_rule(rules);
+      state.ResumeTiming();
+
+      parser.removeRule(prof, *rule);
+    }
+
+    state.SetComplexityN(rule_count);
+  }
+
+  // Latency of replacing the middle rule of a profile of a given size
+  void BM_EditRule(benchmark::State &state)
+  {
+    const auto rule_count = state.range(0);
+    TempProfile profile(rule_count);
+    AppArmor::Parser parser(profile.getPath());
+    const AppArmor::FileRule new_rule("/usr/share/edited/**", "rw"_mode);
+
+    for(auto _ : state) {
+      state.PauseTiming();
+      parser.cancelChanges();
+      auto prof  = parser.getProfileList().front();
+      auto rules = prof.getFileRules();
+      auto rule  = middle_rule(rules);
+      state.ResumeTiming();
+
+      parser.editRule(prof, *rule, new_rule);
+    }
+
+    state.SetComplexityN(rule_count);
+  }
+
+  // Latency of adding one rule to the last of a growing number of profiles
+  void BM_AddRuleProfiles(benchmark::State &state)
+  {
+    AppArmorGenerate::options opts;
+    opts.profiles     = state.range(0);
+    opts.file_rules   = 20;
+    opts.hats         = 1;
+    opts.subprofiles  = 1;
+    opts.conditionals = 1;
+
+    TempProfile profile(AppArmorGenerate::generate(opts));
+    AppArmor::Parser parser(profile.getPath());
+    const AppArmor::FileRule new_rule("/usr/share/added/**", "r"_mode);
+
+    for(auto _ : state) {
+      state.PauseTiming();
+      parser.cancelChanges();
+      auto prof = parser.getProfileList().back();
+      state.ResumeTiming();
+
+      parser.addRule(prof, new_rule);
+    }
+
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Counts the file rules that grant write permission, over every profile of a generated file
+  void BM_ScanWritable(benchmark::State &state)
+  {
+    AppArmorGenerate::options opts;
+    opts.profiles   = state.range(0);
+    opts.file_rules = 200;
+
+    TempProfile profile(AppArmorGenerate::generate(opts));
+    AppArmor::Parser parser(profile.getPath());
+
+    for(auto _ : state) {
+      size_t writable = 0;
+      for(const auto &prof : parser.getProfileList()) {
+        for(const auto &rule : prof.getFileRules()) {
+          writable += rule.getFilemode().getWrite() ? 1 : 0;
+        }
+      }
+      benchmark::DoNotOptimize(writable);
+    }
+
+    state.SetItemsProcessed(state.iterations() * opts.profiles * opts.file_rules);
+  }
+
+  // Adding a batch of rules to a 1000 rule profile, one call at a time
+  void BM_AddRuleBatch(benchmark::State &state)
+  {
+    const auto batch_size = state.range(0);
+    TempProfile profile(1000);
+    AppArmor::Parser parser(profile.getPath());
+    const AppArmor::FileRule new_rule("/usr/share/added/**", "r"_mode);
+
+    for(auto _ : state) {
+      state.PauseTiming();
+      parser.cancelChanges();
+      state.ResumeTiming();
+
+      for(int64_t i = 0; i < batch_size; i++) {
+        auto prof = parser.getProfileList().front();
+        parser.addRule(prof, new_rule);
+      }
+    }
+
+    state.SetComplexityN(batch_size);
+  }
+
+  // Adding the same batch of rules with a single Transaction
+  void BM_AddRuleTransaction(benchmark::State &state)
+  {
+    const auto batch_size = state.range(0);
+    TempProfile profile(1000);
+    AppArmor::Parser parser(profile.getPath());
+    const AppArmor::FileRule new_rule("/usr/share/added/**", "r"_mode);
+
+    for(auto _ : state) {
+      state.PauseTiming();
+      parser.cancelChanges();
+      auto prof = parser.getProfileList().front();
+      state.ResumeTiming();
+
+      auto transaction = parser.beginTransaction();
+      for(int64_t i = 0; i < batch_size; i++) {
+        transaction.addRule(prof, new_rule);
+      }
+      transaction.commit();
+    }
+
+    state.SetComplexityN(batch_size);
+  }
+
+  // Loads every profile in the corpus with Parser::parseAll(), using a given number of threads
+  void BM_ParseAllCorpus(benchmark::State &state)
+  {
+    std::vector<std::string> paths;
+    for(const auto &profile : Corpus::profiles()) {
+      paths.push_back(profile.path);
+    }
+
+    if(paths.empty()) {
+      state.SkipWithError("No example profiles found in " PROFILE_SOURCE_DIR);
+      return;
+    }
+
+    for(auto _ : state) {
+      benchmark::DoNotOptimize(AppArmor::Parser::parseAll(paths, state.range(0)));
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * Corpus::total_bytes()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+  }
+} // namespace
+
+BENCHMARK(BM_ParseAllCorpus)->ArgName("threads")->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_ParserLoad)->RangeMultiplier(10)->Range(100, 100000)->Complexity(benchmark::oN);
+BENCHMARK(BM_RuleMemory)->RangeMultiplier(10)->Range(100, 10000);
+BENCHMARK(BM_GetProfileList)->RangeMultiplier(10)->Range(100, 100000)->Complexity(benchmark::oN);
+BENCHMARK(BM_AddRule)->RangeMultiplier(10)->Range(100, 10000)->Complexity();
+BENCHMARK(BM_RemoveRule)->RangeMultiplier(10)->Range(100, 10000)->Complexity();
+BENCHMARK(BM_EditRule)->RangeMultiplier(10)->Range(100, 10000)->Complexity();
+BENCHMARK(BM_ScanWritable)->RangeMultiplier(4)->Range(4, 256);
+BENCHMARK(BM_AddRuleBatch)->RangeMultiplier(4)->Range(8, 512)->Complexity();
+BENCHMARK(BM_AddRuleTransaction)->RangeMultiplier(4)->Range(8, 512)->Complexity();
+BENCHMARK(BM_AddRuleProfiles)->RangeMultiplier(4)->Range(16, 1024)->Complexity();
@@ -0,0 +1,76 @@
+#ifndef CORPUS_HH
+#define CORPUS_HH
+
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "driver.hh"
+#include "lexer.hh"
+
+// Profiles from the AppArmor parser's test suite (modules/apparmor/parser/tst/simple_tests)
+namespace Corpus {
+  struct Profile {
+    std::string path;
+    std::string contents;
+  };
+
+  // Returns whether the library parses 'contents' without an error
+  inline bool parses(const std::string &contents)
+  {
+    try {
+      Lexer lexer(contents);
+      Driver driver;
+      yy::parser parse(lexer, driver);
+      return parse() == 0 && driver.success;
+    } catch(const std::exception &) {
+      return false;
+    }
+  }
+
+  // Loads every profile that is expected to pass and that this library can parse
+  // The profiles are only loaded once, and are empty if the submodule was not checked out
+  inline const std::vector<Profile> &profiles()
+  {
+    static const std::vector<Profile> corpus = [] {
+      std::vector<Profile> loaded;
+      if(!std::filesystem::is_directory(PROFILE_SOURCE_DIR)) {
+        return loaded;
+      }
+
+      for(const auto &entry : std::filesystem::recursive_directory_iterator(PROFILE_SOURCE_DIR)) {
+        if(!entry.is_regular_file() || entry.path().extension() != ".sd") {
+          continue;
+        }
+
+        std::ifstream stream(entry.path());
+        std::string contents(std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{});
+
+        bool should_pass = contents.find("#=EXRESULT PASS") != std::string::npos;
+        bool disabled    = contents.find("#=DISABLED") != std::string::npos;
+        if(should_pass && !disabled && parses(contents)) {
+          loaded.push_back({entry.path().string(), std::move(contents)});
+        }
+      }
+
+      return loaded;
+    }();
+
+    return corpus;
+  }
+
+  // Returns the combined size of all the profiles in the corpus
+  inline size_t total_bytes()
+  {
+    size_t bytes = 0;
+    for(const auto &profile : profiles()) {
+      bytes += profile.contents.size();
+    }
+    return bytes;
+  }
+} // namespace Corpus
+
+#endif // CORPUS_HH
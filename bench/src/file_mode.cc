@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include "tree/FileMode.hh"
+
+namespace {
+  constexpr std::array<std::string_view, 8> modes = {"r", "rw", "mr", "rix", "rPx", "ra", "rwk", "mrCix"};
+
+  void BM_FileModeParse(benchmark::State &state)
+  {
+    for(auto _ : state) {
+      for(const auto &mode : modes) {
+        benchmark::DoNotOptimize(AppArmor::Tree::FileMode(mode));
+      }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * modes.size()));
+  }
+
+  // Combines the modes of many rules, as done when collecting the permissions granted to a path
+  void BM_FileModeAggregate(benchmark::State &state)
+  {
+    std::vector<AppArmor::Tree::FileMode> rule_modes;
+    for(int64_t i = 0; i < state.range(0); i++) {
+      // Leave out the modes with an exec transition, since different transitions conflict
+      rule_modes.emplace_back(modes.at(static_cast<size_t>(i) % 3));
+    }
+
+    const AppArmor::Tree::FileMode writable("w");
+    for(auto _ : state) {
+      AppArmor::Tree::FileMode aggregate;
+      int64_t count = 0;
+      for(const auto &mode : rule_modes) {
+        aggregate |= mode;
+        count += writable.isSubsetOf(mode) ? 1 : 0;
+      }
+
+      benchmark::DoNotOptimize(aggregate);
+      benchmark::DoNotOptimize(count);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+} // namespace
+
+BENCHMARK(BM_FileModeParse);
+BENCHMARK(BM_FileModeAggregate)->RangeMultiplier(10)->Range(100, 100000);
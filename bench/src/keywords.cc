@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "corpus.hh"
+#include "parser.h"
+
+namespace {
+  // Collects every word the lexer could match as {VARIABLE_NAME} from the corpus,
+  // so the lookups follow the keyword distribution of real profiles
+  std::vector<std::string> corpus_words()
+  {
+    std::vector<std::string> words;
+    for(const auto &profile : Corpus::profiles()) {
+      std::string word;
+      for(const char &ch : profile.contents) {
+        if(std::isalnum(static_cast<unsigned char>(ch)) != 0 || ch == '_') {
+          word.push_back(ch);
+        } else {
+          if(!word.empty() && std::isalpha(static_cast<unsigned char>(word.front())) != 0) {
+            words.push_back(word);
+          }
+          word.clear();
+        }
+      }
+    }
+
+    return words;
+  }
+
+  void BM_KeywordLookup(benchmark::State &state)
+  {
+    static const std::vector<std::string> words = corpus_words();
+    if(words.empty()) {
+      state.SkipWithError("No example profiles found in " PROFILE_SOURCE_DIR);
+      return;
+    }
+
+    for(auto _ : state) {
+      for(const auto &word : words) {
+        benchmark::DoNotOptimize(get_keyword_token(word.c_str(), static_cast<int>(word.size())));
+      }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * words.size()));
+  }
+} // namespace
+
+BENCHMARK(BM_KeywordLookup);
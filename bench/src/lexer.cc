@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+
+#include "corpus.hh"
+#include "driver.hh"
+#include "lexer.hh"
+#include "synthetic.hh"
+
+namespace {
+  // Runs the lexer until it reaches the end of the input, and returns the number of tokens
+  size_t lex_all(Lexer &lexer)
+  {
+    Driver driver;
+    size_t tokens = 0;
+    while(lexer.yylex(driver).kind() != yy::parser::symbol_kind::S_YYEOF) {
+      tokens++;
+    }
+    return tokens;
+  }
+
+  // Lexes through a std::stringstream, the way files used to be re-lexed after every edit
+  void BM_LexStream(benchmark::State &state)
+  {
+    const std::string profile = Synthetic::make_profile(state.range(0));
+
+    for(auto _ : state) {
+      std::stringstream stream;
+      stream << profile;
+
+      Lexer lexer(stream, std::cerr);
+      benchmark::DoNotOptimize(lex_all(lexer));
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * profile.size()));
+  }
+
+  // Lexes directly from the buffer holding the file contents
+  void BM_LexBuffer(benchmark::State &state)
+  {
+    const std::string profile = Synthetic::make_profile(state.range(0));
+
+    for(auto _ : state) {
+      Lexer lexer(profile);
+      benchmark::DoNotOptimize(lex_all(lexer));
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * profile.size()));
+  }
+
+  // Lexes every profile in the corpus
+  void BM_LexCorpus(benchmark::State &state)
+  {
+    const auto &profiles = Corpus::profiles();
+    if(profiles.empty()) {
+      state.SkipWithError("No example profiles found in " PROFILE_SOURCE_DIR);
+      return;
+    }
+
+    for(auto _ : state) {
+      for(const auto &profile : profiles) {
+        Lexer lexer(profile.contents);
+        benchmark::DoNotOptimize(lex_all(lexer));
+      }
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * Corpus::total_bytes()));
+  }
+} // namespace
+
+BENCHMARK(BM_LexCorpus);
+BENCHMARK(BM_LexStream)->RangeMultiplier(10)->Range(100, 100000);
+BENCHMARK(BM_LexBuffer)->RangeMultiplier(10)->Range(100, 100000);
@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+#include <string>
+
+#include "aa-generate.h"
+#include "allocations.hh"
+#include "corpus.hh"
+#include "driver.hh"
+#include "lexer.hh"
+#include "synthetic.hh"
+
+namespace {
+  // Lexes and parses a single profile with a growing number of rules
+  // The time per rule should stay constant, which is checked by the O(N) complexity fit
+  void BM_ParseProfile(benchmark::State &state)
+  {
+    const auto rule_count = state.range(0);
+    const std::string profile = Synthetic::make_profile(rule_count);
+
+    const auto allocations = Allocations::count();
+    for(auto _ : state) {
+      Lexer lexer(profile);
+      Driver driver;
+      yy::parser parse(lexer, driver);
+      parse();
+
+      benchmark::DoNotOptimize(driver.ast);
+    }
+
+    const auto rules = static_cast<double>(state.iterations() * rule_count);
+    state.counters["allocs_per_rule"] = static_cast<double>(Allocations::count() - allocations) / rules;
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * profile.size()));
+    state.SetItemsProcessed(state.iterations() * rule_count);
+    state.SetComplexityN(rule_count);
+  }
+
+  // Parses a growing number of profiles that each have hats, subprofiles, conditional blocks and variables
+  // Like BM_ParseProfile, the time per profile should stay constant
+  void BM_ParseNested(benchmark::State &state)
+  {
+    AppArmorGenerate::options opts;
+    opts.profiles     = state.range(0);
+    opts.file_rules   = 50;
+    opts.link_rules   = 5;
+    opts.abstractions = 2;
+    opts.hats         = 3;
+    opts.subprofiles  = 3;
+    opts.conditionals = 3;
+    opts.variables    = 10;
+    const std::string profile = AppArmorGenerate::generate(opts);
+
+    for(auto _ : state) {
+      Lexer lexer(profile);
+      Driver driver;
+      yy::parser parse(lexer, driver);
+      parse();
+
+      benchmark::DoNotOptimize(driver.ast);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * profile.size()));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Lexes and parses every profile in the corpus
+  void BM_ParseCorpus(benchmark::State &state)
+  {
+    const auto &profiles = Corpus::profiles();
+    if(profiles.empty()) {
+      state.SkipWithError("No example profiles found in " PROFILE_SOURCE_DIR);
+      return;
+    }
+
+    for(auto _ : state) {
+      for(const auto &profile : profiles) {
+        Lexer lexer(profile.contents);
+        Driver driver;
+        yy::parser parse(lexer, driver);
+        parse();
+
+        benchmark::DoNotOptimize(driver.ast);
+      }
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * Corpus::total_bytes()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * profiles.size()));
+  }
+} // namespace
+
+BENCHMARK(BM_ParseCorpus);
+
+BENCHMARK(BM_ParseProfile)
+  ->Arg(10000)
+  ->Arg(50000)
+  ->Arg(100000)
+  ->Unit(benchmark::kMillisecond)
+  ->Complexity(benchmark::oN);
+
+BENCHMARK(BM_ParseNested)
+  ->RangeMultiplier(4)
+  ->Range(16, 1024)
+  ->Unit(benchmark::kMillisecond)
+  ->Complexity(benchmark::oN);
@@ -0,0 +1,25 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "parser.h"
+
+namespace {
+  // Processes a typical file rule path, either with or without an escape sequence
+  void BM_ProcessId(benchmark::State &state)
+  {
+    const bool escaped = state.range(0) != 0;
+    const std::string id = escaped ? "/usr/share/applications/some\\040program/**.desktop"
+                                   : "/usr/share/applications/some-program/**.desktop";
+
+    std::vector<char> buffer(id.size() + 1);
+    for(auto _ : state) {
+      benchmark::DoNotOptimize(processid(buffer.data(), id.data(), static_cast<int>(id.size())));
+      benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * id.size()));
+  }
+} // namespace
+
+BENCHMARK(BM_ProcessId)->ArgName("escaped")->Arg(0)->Arg(1);
@@ -0,0 +1,21 @@
+#ifndef SYNTHETIC_HH
+#define SYNTHETIC_HH
+
+#include <cstddef>
+#include <string>
+
+#include "aa-generate.h"
+
+// Helpers to create large, valid profiles for benchmarking
+namespace Synthetic {
+  // Creates a profile containing 'rule_count' file rules, with an abstraction for every 50 rules
+  inline std::string make_profile(size_t rule_count)
+  {
+    AppArmorGenerate::options opts;
+    opts.file_rules   = rule_count;
+    opts.abstractions = rule_count / 50;
+    return AppArmorGenerate::generate(opts);
+  }
+} // namespace Synthetic
+
+#endif // SYNTHETIC_HH
@@ -1,4 +1,5 @@
 #include "apparmor_parser.hh"
+#include "content_hash.hh"
 #include "parser/driver.hh"
 #include "parser/lexer.hh"
 #include "tree/AbstractionRule.hh"
@@ -6,73 +7,420 @@
 #include "tree/ParseTree.hh"
 #include "tree/RuleNode.hh"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <exception>
 #include <fstream>
 #include <glibmm/spawn.h>
+#include <iterator>
 #include <memory>
 #include <parser_yacc.hh>
+#include <poll.h>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+  // Writes 'header', then the text of 'contents' to a pipe one piece at a time, then closes the pipe
+  // Returns false if the text could not be written, such as when the reading process exited early
+  bool write_to_pipe(int fd, const std::string &header, const AppArmor::PieceTable &contents)
+  {
+    // A pipe closed by the other process should fail the write with EPIPE, rather than end this process with SIGPIPE
+    sigset_t sigpipe_set;
+    sigset_t previous_set;
+    sigset_t pending_set;
+    sigemptyset(&sigpipe_set);
+    sigaddset(&sigpipe_set, SIGPIPE);
+    sigpending(&pending_set);
+    const bool was_pending = sigismember(&pending_set, SIGPIPE) == 1;
+    pthread_sigmask(SIG_BLOCK, &sigpipe_set, &previous_set);
+
+    int write_error = 0;
+    auto write_all = [&](std::string_view remaining) {
+      while(!remaining.empty() && write_error == 0) {
+        auto count = write(fd, remaining.data(), remaining.size());
+        if(count > 0) {
+          remaining.remove_prefix(static_cast<size_t>(count));
+        } else if(count < 0 && errno != EINTR) {
+          write_error = errno;
+        }
+      }
+    };
 
-AppArmor::Parser::Parser(const std::string &path)
-  : path{path}
-{
-    std::ifstream stream(path);
+    write_all(header);
+    for(const auto &piece : contents.pieces()) {
+      write_all(piece);
+    }
+    close(fd);
+
+    // Discard the SIGPIPE raised by the failed write before unblocking it
+    if(write_error == EPIPE && !was_pending) {
+      const timespec no_wait{};
+      while(sigtimedwait(&sigpipe_set, nullptr, &no_wait) == -1 && errno == EINTR) { }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous_set, nullptr);
+
+    return write_error == 0;
+  }
+
+  // Reads from both pipes until they are closed by the other process, then closes them
+  // They are read together, so that a process blocked on writing one of them never waits for us to finish the other
+  std::pair<std::string, std::string> read_from_pipes(int output_fd, int error_fd)
+  {
+    std::array<std::string, 2> results;
+    std::array<pollfd, 2> fds = {pollfd{output_fd, POLLIN, 0}, pollfd{error_fd, POLLIN, 0}};
+    std::array<char, 4096> buffer{};
+
+    size_t open_count = fds.size();
+    while(open_count > 0) {
+      if(poll(fds.data(), fds.size(), -1) < 0) {
+        if(errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+
+      for(size_t i = 0; i < fds.size(); i++) {
+        if(fds[i].fd < 0 || fds[i].revents == 0) {
+          continue;
+        }
 
-    // Read entire file into string and store if for later
-    std::stringstream ss;
-    ss << stream.rdbuf();
-    file_contents = ss.str();
-    old_file_contents = std::string(file_contents);
+        auto count = read(fds[i].fd, buffer.data(), buffer.size());
+        if(count < 0 && (errno == EINTR || errno == EAGAIN)) {
+          continue;
+        }
+        if(count <= 0) {
+          // Closed by the other process, so poll() should ignore it from now on
+          close(fds[i].fd);
+          fds[i].fd = -1;
+          open_count--;
+          continue;
+        }
+
+        results[i].append(buffer.data(), static_cast<size_t>(count));
+      }
+    }
+
+    // Close the pipes that are still open if poll() failed
+    for(const auto &fd : fds) {
+      if(fd.fd >= 0) {
+        close(fd.fd);
+      }
+    }
 
-    // Seek back to beginning of file
+    return {std::move(results[0]), std::move(results[1])};
+  }
+
+  // Returns the number of bytes that a step of the undo or redo history uses
+  uint64_t history_step_size(const std::vector<AppArmor::Patch::Splice> &step)
+  {
+    uint64_t size = sizeof(step);
+    for(const auto &splice : step) {
+      size += sizeof(AppArmor::Patch::Splice) + splice.text.size();
+    }
+    return size;
+  }
+
+  // Returns the splices that undo 'splices', given the text they were applied to
+  // The splices must be sorted by position and must not overlap, as in a Patch
+  std::vector<AppArmor::Patch::Splice> invert_splices(const AppArmor::PieceTable &previous_contents,
+                                                      const std::vector<AppArmor::Patch::Splice> &splices)
+  {
+    std::vector<AppArmor::Patch::Splice> inverse;
+    inverse.reserve(splices.size());
+
+    // Each splice moves the ones after it by the difference in length
+    int64_t delta = 0;
+    for(const auto &splice : splices) {
+      std::string replaced;
+      for(const auto &piece : previous_contents.pieces(splice.pos, splice.length)) {
+        replaced.append(piece);
+      }
+
+      auto pos = static_cast<uint64_t>(static_cast<int64_t>(splice.pos) + delta);
+      inverse.push_back({pos, splice.text.size(), std::move(replaced)});
+      delta += static_cast<int64_t>(splice.text.size()) - static_cast<int64_t>(splice.length);
+    }
+
+    return inverse;
+  }
+
+  // Reads an entire file using a single sized read
+  // Returns an empty string if the file could not be opened
+  std::string read_file(const std::string &path)
+  {
+    std::ifstream stream(path, std::ios::binary);
+    std::string contents;
+
+    if(!stream.is_open()) {
+      return contents;
+    }
+
+    stream.seekg(0, std::ios::end);
+    auto size = stream.tellg();
+    stream.clear();
     stream.seekg(0);
 
-    // Parse the file contents
-    update_from_stream(stream);
+    // Some files do not report their size (such as those in /proc), so read them until the end instead
+    if(size <= 0) {
+      contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+      return contents;
+    }
+
+    contents.resize(static_cast<size_t>(size));
+    stream.read(contents.data(), size);
+    contents.resize(static_cast<size_t>(stream.gcount()));
+    return contents;
+  }
+
+  // Appends the text between two positions of 'contents' to 'outside', leaving out lines that are only a comment
+  void append_outside_text(std::string &outside, const AppArmor::PieceTable &contents, uint64_t start, uint64_t end)
+  {
+    std::string text;
+    for(const auto &piece : contents.pieces(start, end - start)) {
+      text.append(piece);
+    }
+
+    std::string_view remaining = text;
+    while(!remaining.empty()) {
+      auto line_end = remaining.find('\n');
+      auto line     = remaining.substr(0, line_end);
+      remaining     = (line_end == std::string_view::npos) ? std::string_view() : remaining.substr(line_end + 1);
+
+      // '#include' is an include directive rather than a comment
+      auto first = line.find_first_not_of(" \t\r");
+      if(first != std::string_view::npos && line[first] == '#' && line.substr(first, 8) != "#include") {
+        continue;
+      }
+
+      outside.append(line);
+      outside.push_back('\n');
+    }
+  }
+
+  // Handles are unique across every parser, so a profile or rule from another parser is never found in this one
+  // Handles are never reused: a reused rule handle could make an outdated rule find another rule of the same profile
+  std::atomic<uint64_t> next_profile_handle{1};
+  std::atomic<uint64_t> next_rule_handle{1};
+
+  // Rules store their handle in 48 bits (see RuleNode). Every parse gives each parsed rule a new handle,
+  // so this lasts for about 2^48 parsed rules, such as 28 billion reparses of a profile with 10,000 rules
+  constexpr uint64_t max_rule_handle = (uint64_t{1} << 48U) - 1;
+
+  uint64_t new_rule_handle()
+  {
+    // Running out is reported instead of wrapping around to handles that may still be in use
+    uint64_t handle = next_rule_handle++;
+    if(handle > max_rule_handle) {
+      throw std::overflow_error("out of rule handles, since more than 2^48 rules were parsed");
+    }
+
+    return handle;
+  }
+} // namespace
+
+AppArmor::Parser::Parser(const std::string &path)
+  : path{path},
+    file_contents{read_file(path)}
+{
+    // Parse the file contents in place
+    // A pristine copy is only made once the contents are first changed
+    update_from_file_contents();
+    saved_hash = getHash();
 }
 
-void AppArmor::Parser::update_from_file_contents()
+AppArmor::Parser::Parser(const Parser &other)
+  : path{other.path},
+    file_contents{other.file_contents},
+    profile_list{other.profile_list},
+    profiles_hash{other.profiles_hash},
+    outside_hash{other.outside_hash},
+    saved_hash{other.saved_hash},
+    change_count{other.change_count},
+    output_mode{other.output_mode},
+    undo_history{other.undo_history},
+    redo_history{other.redo_history},
+    history_limit{other.history_limit},
+    history_size{other.history_size},
+    source_map{other.source_map}
 {
-    // Put the file contents into a stream
-    std::stringstream stream;
-    stream << file_contents;
-    update_from_stream(stream);
+    // The copied profiles keep their handles and hashes, but the indexes must point into this parser's list
+    for(auto profile = profile_list.begin(); profile != profile_list.end(); profile++) {
+        index_handles(profile);
+    }
 }
 
-void AppArmor::Parser::update_from_stream(std::istream &stream)
+AppArmor::Parser &AppArmor::Parser::operator=(const Parser &other)
 {
-    try
-    {
-        // Perform lexical analysis
-        Lexer lexer(stream, std::cerr);
+    if(this != &other) {
+        Parser copy(other);
+        *this = std::move(copy);
+    }
 
-        // Parse the file
-        Driver driver;
-        yy::parser parse(lexer, driver);
-        parse();
+    return *this;
+}
+
+std::vector<AppArmor::ParseResult> AppArmor::Parser::parseAll(const std::vector<std::string> &paths, unsigned int threads)
+{
+    std::vector<ParseResult> results(paths.size());
 
-        // If parsing was not successful, throw an exception
-        if(!driver.success) {
-            std::throw_with_nested(std::runtime_error("error occured when parsing profile"));
+    if(threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    threads = std::min(threads, static_cast<unsigned int>(paths.size()));
+
+    // Each worker takes the next unparsed file, and stores its result at the same index as its path
+    std::atomic<size_t> next_index{0};
+    auto worker = [&]() {
+        for(size_t i = next_index++; i < paths.size(); i = next_index++) {
+            ParseResult &result = results[i];
+            result.path = paths[i];
+
+            try {
+                result.parser.emplace(paths[i]);
+            } catch(const std::exception &ex) {
+                result.error = ex.what();
+            }
         }
+    };
 
-        // Create or update the list of profiles
-        initializeProfileList(driver.ast);
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for(unsigned int i = 0; i < threads; i++) {
+        pool.emplace_back(worker);
     }
-    catch (const std::runtime_error &ex)
-    {
-        file_contents = old_file_contents;
-        std::throw_with_nested(ex);
+
+    for(auto &thread : pool) {
+        thread.join();
     }
+
+    return results;
+}
+
+void AppArmor::Parser::update_from_file_contents()
+{
+    // Scan the pieces of the file contents in place
+    Lexer lexer(file_contents.pieces());
+    update_from_lexer(lexer);
+    change_count++;
+}
+
+void AppArmor::Parser::update_from_lexer(Lexer &lexer)
+{
+    // Parse the file
+    Driver driver;
+    yy::parser parse(lexer, driver);
+    parse();
+
+    // If parsing was not successful, throw an exception
+    if(!driver.success) {
+        std::throw_with_nested(std::runtime_error("error occured when parsing profile"));
+    }
+
+    // Create or update the list of profiles
+    initializeProfileList(driver.ast);
+    source_map = std::move(driver.source_map);
 }
 
 void AppArmor::Parser::initializeProfileList(const std::shared_ptr<AppArmor::Tree::ParseTree> &ast)
 {
-    profile_list = std::list<Profile>();
-    auto astList = ast->profileList;
-    for (auto prof_iter = astList->begin(); prof_iter != astList->end(); prof_iter++){
-        profile_list.push_back(*prof_iter);
+    // The tree is discarded after parsing, so take its profiles instead of copying them
+    profile_list = std::move(*ast->profileList);
+
+    // Every profile was parsed again, so the handles of the previous profiles are outdated
+    profile_index.clear();
+    rule_index.clear();
+    profiles_hash = 0;
+    for(auto profile = profile_list.begin(); profile != profile_list.end(); profile++) {
+        index_profile(profile);
     }
+
+    // The text outside of the profiles (such as variables and includes) only changes when the whole file is parsed again
+    std::string outside;
+    uint64_t start = 0;
+    for(const auto &profile : profile_list) {
+        append_outside_text(outside, file_contents, start, profile.getStartPosition());
+        start = profile.getEndPosition();
+    }
+    append_outside_text(outside, file_contents, start, file_contents.size());
+
+    ContentHash hash;
+    hash.addText(outside);
+    outside_hash = hash.value();
+}
+
+void AppArmor::Parser::index_profile(std::list<Profile>::iterator profile)
+{
+    profile->handle = next_profile_handle++;
+
+    std::string storage;
+    ProfileHasher hasher(profile_text(*profile, storage), profile->getStartPosition());
+    ContentHash profile_hash = hasher.header(*profile);
+
+    profile->visitMutable([&](auto &rule) {
+        profile_hash.add(hasher.hash(rule));
+
+        // Subprofiles and hats are ProfileRules, which are not rules that can be removed or edited
+        if constexpr(std::is_base_of_v<RuleNode, std::remove_cvref_t<decltype(rule)>>) {
+            RuleNode &node = rule;
+            node.handle = new_rule_handle();
+        }
+    });
+
+    profile->content_hash = profile_hash.value();
+    profiles_hash += profile->content_hash;
+
+    index_handles(profile);
+}
+
+void AppArmor::Parser::index_handles(std::list<Profile>::iterator profile)
+{
+    const uint64_t profile_handle = profile->handle;
+    profile_index.emplace(profile_handle, profile);
+
+    profile->visitMutable([&](auto &rule) {
+        if constexpr(std::is_base_of_v<RuleNode, std::remove_cvref_t<decltype(rule)>>) {
+            RuleNode &node = rule;
+            rule_index.emplace(node.getHandle(), RuleEntry{profile_handle, &node});
+        }
+    });
+}
+
+std::string_view AppArmor::Parser::profile_text(const Profile &profile, std::string &storage) const
+{
+    // The text is used in place, unless it was split into several pieces by earlier changes
+    const uint64_t start = profile.getStartPosition();
+    auto pieces = file_contents.pieces(start, profile.getEndPosition() - start);
+    if(pieces.size() == 1) {
+        return pieces.front();
+    }
+
+    storage.clear();
+    for(const auto &piece : pieces) {
+        storage.append(piece);
+    }
+
+    return storage;
+}
+
+void AppArmor::Parser::unindex_profile(const Profile &profile)
+{
+    profile_index.erase(profile.getHandle());
+    profiles_hash -= profile.getHash();
+
+    profile.visit([&](const auto &rule) {
+        if constexpr(std::is_base_of_v<RuleNode, std::remove_cvref_t<decltype(rule)>>) {
+            rule_index.erase(rule.getHandle());
+        }
+    });
 }
 
 std::string AppArmor::Parser::getPath() const
@@ -80,18 +428,22 @@ std::string AppArmor::Parser::getPath() const
     return path;
 }
 
-std::list<AppArmor::Profile> AppArmor::Parser::getProfileList() const
+const std::list<AppArmor::Profile> &AppArmor::Parser::getProfileList() const
 {
     return profile_list;
 }
 
-void AppArmor::Parser::checkProfileValid(Profile &profile)
+const AppArmor::SourceMap &AppArmor::Parser::getSourceMap() const
+{
+    return source_map;
+}
+
+std::list<AppArmor::Profile>::iterator AppArmor::Parser::checkProfileValid(const Profile &profile)
 {
     // Attempt to find profile from the list and return on success
-    for(const Profile &prof : profile_list) {
-        if(profile == prof) {
-            return;
-        }
+    auto found = profile_index.find(profile.getHandle());
+    if(found != profile_index.end()) {
+        return found->second;
     }
 
     // Profile was not found so throw an exception
@@ -100,12 +452,185 @@ void AppArmor::Parser::checkProfileValid(Profile &profile)
     throw std::domain_error(message.str());
 }
 
+const AppArmor::RuleNode &AppArmor::Parser::checkRuleValid(const Profile &profile, const RuleNode &rule) const
+{
+    // The rule must belong to this version of the profile, and be of the same kind as when it was parsed
+    auto found = rule_index.find(rule.getHandle());
+    if(found != rule_index.end() &&
+       found->second.profile_handle == profile.getHandle() &&
+       found->second.rule->getRuleKind() == rule.getRuleKind()) {
+        return *found->second.rule;
+    }
+
+    std::stringstream message;
+    message << "Invalid rule was given as argument. This rule could not be found in Profile: " << profile.name() << ". Was it created using a different or outdated AppArmor::Parser object?\n";
+    throw std::domain_error(message.str());
+}
+
+void AppArmor::Parser::splice(std::list<Profile>::iterator profile,
+                              uint64_t pos,
+                              uint64_t length,
+                              const std::string &text,
+                              std::ostream &output)
+{
+    // Copying the table is cheap, and allows the change to be undone if it does not parse
+    PieceTable previous_contents = file_contents;
+    std::vector<Patch::Splice> splices{{pos, length, text}};
+    file_contents.replace(pos, length, text);
+    update_after_splices(profile, previous_contents, splices);
+
+    record_change(previous_contents, splices);
+    write_output(output, previous_contents, std::move(splices));
+}
+
+void AppArmor::Parser::update_after_splices(std::list<Profile>::iterator profile,
+                                            const PieceTable &previous_contents,
+                                            const std::vector<Patch::Splice> &splices)
+{
+    if(splices.empty()) {
+        return;
+    }
+
+    if(profile == profile_list.end()) {
+        profile = std::find_if(profile_list.begin(), profile_list.end(), [&](const Profile &candidate) {
+            return splices.front().pos >= candidate.getStartPosition() && splices.front().pos <= candidate.getEndPosition();
+        });
+    }
+
+    // Changes that stay inside one profile only need that profile to be parsed again
+    int64_t delta = 0;
+    for(const auto &splice : splices) {
+        delta += static_cast<int64_t>(splice.text.size()) - static_cast<int64_t>(splice.length);
+    }
+
+    // Text spliced in at the very start or end of a profile (such as an include added before it) is outside of it,
+    // so the text around the profiles and its hash must be updated by parsing the whole file
+    const auto &last = splices.back();
+    bool inside_profile = profile != profile_list.end() &&
+                          splices.front().pos > profile->getStartPosition() &&
+                          last.pos + last.length < profile->getEndPosition();
+
+    if(inside_profile && reparse_profile(profile, delta)) {
+        // From last to first, so the positions of the earlier splices do not move
+        for(auto splice = splices.rbegin(); splice != splices.rend(); splice++) {
+            source_map.replaceText(splice->pos, splice->length, splice->text);
+        }
+    } else {
+        try {
+            update_from_file_contents();
+        } catch(...) {
+            file_contents = previous_contents;
+            throw;
+        }
+    }
+
+    change_count++;
+}
+
+void AppArmor::Parser::record_change(const PieceTable &previous_contents, const std::vector<Patch::Splice> &splices)
+{
+    // A change without splices (such as an empty patch) changed nothing, so it must not forget what was undone
+    if(splices.empty()) {
+        return;
+    }
+
+    // Each step is counted once when it is added and once when it is forgotten, so clearing costs nothing extra on average
+    for(const auto &step : redo_history) {
+        history_size -= history_step_size(step);
+    }
+    redo_history.clear();
+
+    undo_history.push_back(invert_splices(previous_contents, splices));
+    history_size += history_step_size(undo_history.back());
+    trim_history();
+}
+
+void AppArmor::Parser::trim_history()
+{
+    // Only the oldest changes can be forgotten, since each step undoes the text left by the step after it
+    while(history_size > history_limit && !undo_history.empty()) {
+        history_size -= history_step_size(undo_history.front());
+        undo_history.pop_front();
+    }
+    while(history_size > history_limit && !redo_history.empty()) {
+        history_size -= history_step_size(redo_history.front());
+        redo_history.pop_front();
+    }
+}
+
+bool AppArmor::Parser::step_history(std::deque<HistoryStep> &from, std::deque<HistoryStep> &to, std::ostream &output)
+{
+    if(from.empty()) {
+        return false;
+    }
+
+    const HistoryStep &step = from.back();
+    PieceTable previous_contents = file_contents;
+    for(auto splice = step.rbegin(); splice != step.rend(); splice++) {
+        file_contents.replace(splice->pos, splice->length, splice->text);
+    }
+
+    update_after_splices(profile_list.end(), previous_contents, step);
+
+    // The step is only moved once the text parsed, so a failed step can be tried again
+    to.push_back(invert_splices(previous_contents, step));
+    history_size += history_step_size(to.back());
+    history_size -= history_step_size(step);
+    HistoryStep applied = std::move(from.back());
+    from.pop_back();
+    trim_history();
+
+    write_output(output, previous_contents, std::move(applied));
+    return true;
+}
+
+void AppArmor::Parser::write_output(std::ostream &output, const PieceTable &previous_contents, std::vector<Patch::Splice> splices) const
+{
+    // Push changes to 'output'
+    if(output_mode == OutputMode::Patch) {
+        output << Patch(Patch::hash(previous_contents), std::move(splices));
+    } else {
+        output << file_contents;
+    }
+}
+
+bool AppArmor::Parser::reparse_profile(std::list<Profile>::iterator profile, int64_t delta)
+{
+    const uint64_t start = profile->getStartPosition();
+    const uint64_t end   = profile->getEndPosition() + static_cast<uint64_t>(delta);
+
+    try {
+        // Lex only the text of this profile, but keep the positions relative to the whole file
+        Lexer lexer(file_contents.pieces(start, end - start));
+        Driver driver;
+        driver.yylloc = {.first_pos = start, .last_pos = start};
+
+        yy::parser parse(lexer, driver);
+        parse();
+
+        if(!driver.success || driver.ast->profileList->size() != 1) {
+            return false;
+        }
+
+        unindex_profile(*profile);
+        *profile = std::move(driver.ast->profileList->front());
+        index_profile(profile);
+    } catch(const std::exception &) {
+        // A full parse will report the error
+        return false;
+    }
+
+    // Everything after the profile moved by the change in its length
+    for(auto next = std::next(profile); next != profile_list.end(); next++) {
+        next->shiftPosition(delta);
+    }
+
+    return true;
+}
+
 template<AppArmor::RuleDerived RuleType>
 void AppArmor::Parser::removeRule(Profile &profile, RuleType &rule)
 {
-    checkProfileValid(profile);
-    profile.checkRuleValid(rule);
-
     std::stringstream output;
     removeRule(profile, rule, output);
 }
@@ -113,19 +638,17 @@ void AppArmor::Parser::removeRule(Profile &profile, RuleType &rule)
 template<AppArmor::RuleDerived RuleType>
 void AppArmor::Parser::removeRule(Profile &profile, RuleType &rule, std::ostream &output)
 {
-    checkProfileValid(profile);
-    profile.checkRuleValid(rule);
+    auto prof = checkProfileValid(profile);
+
+    // Use this parser's copy of the rule, whose position is up to date even if other profiles were changed since 'rule' was copied
+    const auto &stored_rule = checkRuleValid(*prof, rule);
 
     // Erase the rule from 'file_contents'
-    auto start_pos = static_cast<uint>(rule.getStartPosition()) - 1;
-    auto end_pos   = rule.getEndPosition();
+    auto start_pos = stored_rule.getStartPosition();
+    auto end_pos   = stored_rule.getEndPosition();
     auto length    = end_pos - start_pos;
 
-    file_contents.erase(start_pos, length);
-
-    // Push changes to 'output' and update changes
-    output << file_contents;
-    update_from_file_contents();
+    splice(prof, start_pos, length, "", output);
 }
 
 template<AppArmor::RuleDerived RuleType>
@@ -138,18 +661,14 @@ void AppArmor::Parser::addRule(Profile &profile, const RuleType &newRule)
 template<AppArmor::RuleDerived RuleType>
 void AppArmor::Parser::addRule(Profile &profile, const RuleType &newRule, std::ostream &output)
 {
-    checkProfileValid(profile);
+    auto prof = checkProfileValid(profile);
 
     // Get the position of the last rule
-    auto pos = profile.getRuleEndPosition();
+    auto pos = prof->getRuleEndPosition();
 
     // Create and insert the rule (TODO: Fix possible invalid rules and injection of extra rules)
     std::string addRule = "  " + newRule.operator std::string() + '\n';
-    file_contents.insert(pos, addRule);
-
-    // Push changes to 'output' and update changes
-    output << file_contents;
-    update_from_file_contents();
+    splice(prof, pos, 0, addRule, output);
 }
 
 void AppArmor::Parser::editRule(Profile &profile,
@@ -165,60 +684,175 @@ void AppArmor::Parser::editRule(Profile &profile,
                                 const FileRule &newRule,
                                 std::ostream &output)
 {
-    checkProfileValid(profile);
-    profile.checkRuleValid(oldRule);
+    auto prof = checkProfileValid(profile);
+    const auto &stored_rule = checkRuleValid(*prof, oldRule);
 
-    // Remove and replace the fileRule from 'file_contents'
-    auto start_pos = oldRule.getStartPosition() - 1;
-    auto end_pos   = oldRule.getEndPosition();
+    // Replace the old rule in 'file_contents'
+    auto start_pos = stored_rule.getStartPosition();
+    auto end_pos   = stored_rule.getEndPosition();
     auto length    = end_pos - start_pos;
 
-    // Remove the old rule
-    file_contents.erase(start_pos, length);
-
-    // Create and insert the new rule (TODO: Fix possible invalid rules and injection of extra rules)
+    // Create the new rule (TODO: Fix possible invalid rules and injection of extra rules)
     std::string addRule = newRule.operator std::string();
-    file_contents.insert(start_pos, addRule);
+    splice(prof, start_pos, length, addRule, output);
+}
 
-    // Push changes to 'output' and update changes
-    output << file_contents;
-    update_from_file_contents();
+AppArmor::Transaction AppArmor::Parser::beginTransaction()
+{
+    return Transaction(*this);
 }
 
 void AppArmor::Parser::updateFromString(const std::string &new_file_contents)
 {
-    std::stringstream stream;
-    stream << new_file_contents;
-    update_from_stream(stream);
-    file_contents = new_file_contents;
+    // Only the text between the parts at either end that did not change is replaced and kept in the history,
+    // so a small edit to a large file does not use up the history
+    const std::string previous_text = file_contents.operator std::string();
+    const auto shortest = std::min(previous_text.size(), new_file_contents.size());
+
+    size_t prefix = 0;
+    while(prefix < shortest && previous_text[prefix] == new_file_contents[prefix]) {
+        prefix++;
+    }
+
+    size_t suffix = 0;
+    while(suffix < shortest - prefix &&
+          previous_text[previous_text.size() - suffix - 1] == new_file_contents[new_file_contents.size() - suffix - 1]) {
+        suffix++;
+    }
+
+    if(prefix == previous_text.size() && prefix == new_file_contents.size()) {
+        return;
+    }
+
+    Patch::Splice splice{prefix, previous_text.size() - prefix - suffix,
+                         new_file_contents.substr(prefix, new_file_contents.size() - prefix - suffix)};
+
+    // The profiles are hashed from 'file_contents', so it is changed first and put back if the string does not parse
+    PieceTable previous_contents = file_contents;
+    file_contents.replace(splice.pos, splice.length, splice.text);
+
+    try {
+        update_from_file_contents();
+    } catch(...) {
+        file_contents = std::move(previous_contents);
+        throw;
+    }
+
+    record_change(previous_contents, {std::move(splice)});
+}
+
+void AppArmor::Parser::setOutputMode(OutputMode mode)
+{
+    output_mode = mode;
+}
+
+AppArmor::OutputMode AppArmor::Parser::getOutputMode() const
+{
+    return output_mode;
+}
+
+void AppArmor::Parser::applyPatch(const Patch &patch)
+{
+    // Checks the hash and bounds of the patch before anything is changed
+    PieceTable previous_contents = file_contents;
+    patch.apply(file_contents);
+
+    update_after_splices(profile_list.end(), previous_contents, patch.getSplices());
+    record_change(previous_contents, patch.getSplices());
+}
+
+bool AppArmor::Parser::undo()
+{
+    std::stringstream output;
+    return undo(output);
+}
+
+bool AppArmor::Parser::undo(std::ostream &output)
+{
+    return step_history(undo_history, redo_history, output);
+}
+
+bool AppArmor::Parser::redo()
+{
+    std::stringstream output;
+    return redo(output);
+}
+
+bool AppArmor::Parser::redo(std::ostream &output)
+{
+    return step_history(redo_history, undo_history, output);
+}
+
+bool AppArmor::Parser::canUndo() const
+{
+    return !undo_history.empty();
+}
+
+bool AppArmor::Parser::canRedo() const
+{
+    return !redo_history.empty();
+}
+
+void AppArmor::Parser::setHistoryLimit(uint64_t bytes)
+{
+    history_limit = bytes;
+    trim_history();
 }
 
 bool AppArmor::Parser::hasChanges()
 {
-    return file_contents != old_file_contents;
+    return getHash() != saved_hash || !file_contents.isOriginal();
+}
+
+uint64_t AppArmor::Parser::getHash() const
+{
+    return profiles_hash + outside_hash;
 }
 
 int AppArmor::Parser::saveChanges()
 {
-  const std::vector<std::string> command = {"pkexec", "aa-replace", getPath(), file_contents};
+  // The contents are written to the standard input of aa-replace, rather than passed as an argument,
+  // since a single argument is limited to 128 KiB (MAX_ARG_STRLEN) and would be copied into the new process
+  const std::vector<std::string> command = {"pkexec", "aa-replace", getPath()};
   std::vector<std::string> envp = { "PATH=/usr/bin:/usr/sbin:/usr/local/bin" };
 
-  std::string output;
-  std::string error;
+  Glib::Pid pid = 0;
+  int input_fd  = -1;
+  int output_fd = -1;
+  int error_fd  = -1;
+
+  Glib::spawn_async_with_pipes("/usr/sbin/",
+                               command,
+                               envp,
+                               Glib::SpawnFlags::SPAWN_SEARCH_PATH_FROM_ENVP | Glib::SpawnFlags::SPAWN_DO_NOT_REAP_CHILD,
+                               {},
+                               &pid,
+                               &input_fd,
+                               &output_fd,
+                               &error_fd);
+
+  // aa-replace reads all of its input before writing any output, so the output is read once the input is written
+  // The size comes first, so that aa-replace only replaces the file once all of the contents arrived
+  bool written = write_to_pipe(input_fd, std::to_string(file_contents.size()) + '\n', file_contents);
+  auto [output, error] = read_from_pipes(output_fd, error_fd);
+
+  int status = 0;
   int exit_status = 1;
+  if(waitpid(pid, &status, 0) == pid && WIFEXITED(status)) {
+    exit_status = WEXITSTATUS(status);
+  }
+  Glib::spawn_close_pid(pid);
 
-  Glib::spawn_sync("/usr/sbin/",
-                   command,
-                   envp,
-                   Glib::SpawnFlags::SPAWN_SEARCH_PATH_FROM_ENVP,
-                   {},
-                   &output,
-                   &error,
-                   &exit_status);
+  if(exit_status == 0 && !written) {
+    exit_status = 1;
+  }
 
   if(exit_status == 0) {
     std::cout << output;
-    old_file_contents = std::string(file_contents);
+
+    // The saved contents are now the original contents
+    file_contents = PieceTable(file_contents.operator std::string());
+    saved_hash = getHash();
   } else {
     std::cerr << error;
   }
@@ -228,14 +862,124 @@ int AppArmor::Parser::saveChanges()
 
 void AppArmor::Parser::cancelChanges()
 {
-    file_contents = std::string(old_file_contents);
-    update_from_file_contents();
+    // If the contents were never changed, then there is nothing to revert
+    if(!file_contents.isOriginal()) {
+        file_contents.revert();
+        update_from_file_contents();
+    }
+
+    undo_history.clear();
+    redo_history.clear();
+    history_size = 0;
 }
 
 AppArmor::Parser::operator std::string() const
 {
-    std::string return_string(file_contents);
-    return return_string;
+    return file_contents.operator std::string();
+}
+
+AppArmor::Transaction::Transaction(Parser &parser)
+  : parser{parser}
+{   }
+
+template<AppArmor::RuleDerived RuleType>
+void AppArmor::Transaction::removeRule(Profile &profile, RuleType &rule)
+{
+    auto prof = parser.checkProfileValid(profile);
+    const auto &stored_rule = parser.checkRuleValid(*prof, rule);
+
+    auto start_pos = stored_rule.getStartPosition();
+    auto end_pos   = stored_rule.getEndPosition();
+    queue({start_pos, end_pos - start_pos, ""});
+}
+
+template<AppArmor::RuleDerived RuleType>
+void AppArmor::Transaction::addRule(Profile &profile, const RuleType &newRule)
+{
+    auto prof = parser.checkProfileValid(profile);
+
+    // Create and insert the rule (TODO: Fix possible invalid rules and injection of extra rules)
+    std::string addRule = "  " + newRule.operator std::string() + '\n';
+    queue({prof->getRuleEndPosition(), 0, std::move(addRule)});
+}
+
+template<AppArmor::RuleDerived RuleType>
+void AppArmor::Transaction::editRule(Profile &profile, RuleType &oldRule, const RuleType &newRule)
+{
+    auto prof = parser.checkProfileValid(profile);
+    const auto &stored_rule = parser.checkRuleValid(*prof, oldRule);
+
+    auto start_pos = stored_rule.getStartPosition();
+    auto end_pos   = stored_rule.getEndPosition();
+    queue({start_pos, end_pos - start_pos, newRule.operator std::string()});
+}
+
+size_t AppArmor::Transaction::size() const
+{
+    return splices.size();
+}
+
+void AppArmor::Transaction::commit()
+{
+    std::stringstream output;
+    commit(output);
+}
+
+void AppArmor::Transaction::commit(std::ostream &output)
+{
+    // Nothing was queued, so there is no change to parse, write or undo
+    if(splices.empty()) {
+        return;
+    }
+
+    // The positions of the queued changes are only valid for the text they were queued against
+    if(parser.change_count != change_count) {
+        splices.clear();
+        throw std::domain_error("Parser was changed after this transaction was started, so its changes are outdated");
+    }
+
+    // Apply the splices in order of position
+    // Splices at the same position (such as rules added to the same profile) keep the order they were queued in
+    std::stable_sort(splices.begin(), splices.end(), [](const Splice &first, const Splice &second) {
+        return first.pos < second.pos;
+    });
+
+    // Every position refers to the original text, so no two splices may replace the same characters
+    for(size_t i = 1; i < splices.size(); i++) {
+        const auto &previous = splices[i - 1];
+        if(previous.pos + previous.length > splices[i].pos) {
+            splices.clear();
+            throw std::domain_error("Transaction contains overlapping changes, such as removing or editing the same rule twice");
+        }
+    }
+
+    // Apply the splices from last to first, so the positions of the earlier splices do not move
+    PieceTable previous_contents = parser.file_contents;
+    for(auto splice = splices.rbegin(); splice != splices.rend(); splice++) {
+        parser.file_contents.replace(splice->pos, splice->length, splice->text);
+    }
+    auto applied = std::move(splices);
+    splices.clear();
+
+    // Parse once (only the changed profile, if every change is inside one), and put everything back if that fails
+    parser.update_after_splices(parser.profile_list.end(), previous_contents, applied);
+
+    parser.record_change(previous_contents, applied);
+    parser.write_output(output, previous_contents, std::move(applied));
+}
+
+void AppArmor::Transaction::rollback()
+{
+    splices.clear();
+}
+
+void AppArmor::Transaction::queue(Splice splice)
+{
+    if(splices.empty()) {
+        change_count = parser.change_count;
+    }
+
+    splices.push_back(std::move(splice));
 }
 
 // Link removeRule() functions
@@ -243,11 +987,13 @@ template void AppArmor::Parser::removeRule<AppArmor::Tree::FileRule>(Profile &pr
 template void AppArmor::Parser::removeRule<AppArmor::Tree::LinkRule>(Profile &profile, AppArmor::Tree::LinkRule &rule);
 template void AppArmor::Parser::removeRule<AppArmor::Tree::RuleList>(Profile &profile, AppArmor::Tree::RuleList &rule);
 template void AppArmor::Parser::removeRule<AppArmor::Tree::AbstractionRule>(Profile &profile, AppArmor::Tree::AbstractionRule &rule);
+template void AppArmor::Parser::removeRule<AppArmor::Tree::GenericRule>(Profile &profile, AppArmor::Tree::GenericRule &rule);
 
 template void AppArmor::Parser::removeRule<AppArmor::Tree::FileRule>(Profile &profile, AppArmor::Tree::FileRule &rule, std::ostream &output);
 template void AppArmor::Parser::removeRule<AppArmor::Tree::LinkRule>(Profile &profile, AppArmor::Tree::LinkRule &rule, std::ostream &output);
 template void AppArmor::Parser::removeRule<AppArmor::Tree::RuleList>(Profile &profile, AppArmor::Tree::RuleList &rule, std::ostream &output);
 template void AppArmor::Parser::removeRule<AppArmor::Tree::AbstractionRule>(Profile &profile, AppArmor::Tree::AbstractionRule &rule, std::ostream &output);
+template void AppArmor::Parser::removeRule<AppArmor::Tree::GenericRule>(Profile &profile, AppArmor::Tree::GenericRule &rule, std::ostream &output);
 
 // Link addRule() functions
 template void AppArmor::Parser::addRule<AppArmor::Tree::FileRule>(AppArmor::Profile&, AppArmor::FileRule const&);
@@ -255,3 +1001,16 @@ template void AppArmor::Parser::addRule<AppArmor::Tree::AbstractionRule>(AppArmo
 
 template void AppArmor::Parser::addRule<AppArmor::Tree::FileRule>(AppArmor::Profile&, AppArmor::FileRule const&, std::ostream&);
 template void AppArmor::Parser::addRule<AppArmor::Tree::AbstractionRule>(AppArmor::Profile&, AppArmor::AbstractionRule const&, std::ostream&);
+
+// Link Transaction functions
+template void AppArmor::Transaction::removeRule<AppArmor::Tree::FileRule>(Profile &profile, AppArmor::Tree::FileRule &rule);
+template void AppArmor::Transaction::removeRule<AppArmor::Tree::LinkRule>(Profile &profile, AppArmor::Tree::LinkRule &rule);
+template void AppArmor::Transaction::removeRule<AppArmor::Tree::RuleList>(Profile &profile, AppArmor::Tree::RuleList &rule);
+template void AppArmor::Transaction::removeRule<AppArmor::Tree::AbstractionRule>(Profile &profile, AppArmor::Tree::AbstractionRule &rule);
+template void AppArmor::Transaction::removeRule<AppArmor::Tree::GenericRule>(Profile &profile, AppArmor::Tree::GenericRule &rule);
+
+template void AppArmor::Transaction::addRule<AppArmor::Tree::FileRule>(Profile &profile, const AppArmor::Tree::FileRule &newRule);
+template void AppArmor::Transaction::addRule<AppArmor::Tree::AbstractionRule>(Profile &profile, const AppArmor::Tree::AbstractionRule &newRule);
+
+template void AppArmor::Transaction::editRule<AppArmor::Tree::FileRule>(Profile &profile, AppArmor::Tree::FileRule &oldRule, const AppArmor::Tree::FileRule &newRule);
+template void AppArmor::Transaction::editRule<AppArmor::Tree::AbstractionRule>(Profile &profile, AppArmor::Tree::AbstractionRule &oldRule, const AppArmor::Tree::AbstractionRule &newRule);
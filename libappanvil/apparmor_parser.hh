@@ -2,15 +2,28 @@
 #define APPARMOR_PARSER_HH
 
 #include <algorithm>
+#include <deque>
 #include <fstream>
 #include <list>
+#include <memory>
+#include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include "patch.hh"
+#include "piece_table.hh"
+#include "profile_diff.hh"
+#include "source_map.hh"
 #include "tree/AbstractionRule.hh"
 #include "tree/FileRule.hh"
 #include "tree/ProfileRule.hh"
 
+// Declare the lexer, so that it can be referenced without including generated headers
+class Lexer;
+
 namespace AppArmor {
   namespace Tree {
     class ParseTree;
@@ -19,21 +32,70 @@ namespace AppArmor {
   using Profile = Tree::ProfileRule;
   using FileRule = Tree::FileRule;
   using AbstractionRule = Tree::AbstractionRule;
+  using GenericRule = Tree::GenericRule;
   using RuleNode = Tree::RuleNode;
+  using FileMode = Tree::FileMode;
+
+  // 'using namespace AppArmor::Literals;' allows writing FileRule("/bin/echo", "ux"_mode)
+  namespace Literals {
+    using Tree::Literals::operator""_mode;
+  } // namespace Literals
 
   // Concept checks whether class is a subclass of RuleNode
   // Does not match RuleNode
   template<class RuleType>
   concept RuleDerived = std::is_base_of<RuleNode, RuleType>::value && !std::is_base_of<RuleType, RuleNode>::value;
 
+  struct ParseResult;
+  class Transaction;
+
+  // What the overloads that take 'std::ostream &output' write after each change
+  enum class OutputMode : uint8_t {
+    // The whole file
+    Contents,
+
+    // A Patch from the previous contents, which Parser::applyPatch() or Patch::apply() turns into the new contents
+    Patch
+  };
+
   class Parser {
     public:
       explicit Parser(const std::string &path);
 
+      // A copy finds the same profiles and rules as the original, but changing one does not change the other
+      Parser(const Parser &other);
+      Parser &operator=(const Parser &other);
+      Parser(Parser &&) = default;
+      Parser &operator=(Parser &&) = default;
+      ~Parser() = default;
+
+      /**
+      * @brief Parses many files at once, using a pool of threads
+      *
+      * @details
+      * Each file is parsed independently, so one file failing to parse does not stop the others.
+      * The results are in the same order as 'paths', no matter which thread parsed each file.
+      *
+      * @param paths the files to parse
+      * @param threads the number of threads to use, or 0 to use one per hardware thread
+      *
+      * @returns one ParseResult for each path
+      */
+      static std::vector<ParseResult> parseAll(const std::vector<std::string> &paths, unsigned int threads = 0);
+
       // Returns the path that was used to create the constructor
       std::string getPath() const;
 
-      std::list<Profile> getProfileList() const;
+      // Returns the profiles in this file, without copying them
+      // The list and iterators into it stay valid until this parser is changed
+      //
+      // Each profile and rule has a handle (see ProfileRule::getHandle()), which removeRule(), addRule() and editRule() look up
+      // in a hash table instead of comparing whole profiles. A copy of a profile stays usable until that profile itself is changed,
+      // even if changes to other profiles moved it in the file.
+      const std::list<Profile> &getProfileList() const;
+
+      // Returns the map used to convert character positions (from getStartPosition(), etc.) to line and column numbers
+      const SourceMap &getSourceMap() const;
 
       template<RuleDerived RuleType>
       void removeRule(Profile &profile, RuleType &rule);
@@ -50,6 +112,72 @@ namespace AppArmor {
       void editRule(Profile &profile, FileRule &oldRule, const FileRule &newRule);
       void editRule(Profile &profile, FileRule &oldRule, const FileRule &newRule, std::ostream &output);
 
+      // Starts a Transaction, which queues many changes and applies them with a single parse
+      Transaction beginTransaction();
+
+      // Sets what is written to 'output' after each change (OutputMode::Contents unless set)
+      void setOutputMode(OutputMode mode);
+      OutputMode getOutputMode() const;
+
+      /**
+      * @brief Applies a patch written by a parser in OutputMode::Patch, such as a parser of the same file in another process
+      *
+      * @details
+      * Only the replaced text is changed, and the profile it is in is parsed again if possible (as with addRule(), etc.).
+      * If the patch cannot be applied, there should be no changes.
+      *
+      * @throws std::domain_error if the patch was made for different text than the text of this parser
+      * @throws std::out_of_range if a splice of the patch is outside of the text of this parser
+      * @throws std::runtime_error if the patched text did not parse correctly
+      */
+      void applyPatch(const Patch &patch);
+
+      /**
+      * @brief Undoes the last change, from addRule(), removeRule(), editRule(), a Transaction, applyPatch() or updateFromString()
+      *
+      * @details
+      * Each change is stored as the replacements that undo it, which hold only the text that was replaced.
+      * Stepping back or forward applies those replacements and parses only the changed profile again if possible,
+      * so the whole file is never copied. The oldest changes are forgotten once the history is larger than setHistoryLimit().
+      * The limit does not cover the file itself: text inserted by a change and replaced since is freed once it takes up
+      * more memory than the inserted text that is still in the file (see PieceTable).
+      * Undone changes can be redone until another change is made. cancelChanges() forgets both.
+      *
+      * @returns false if there was no change to undo
+      *
+      * @throws std::runtime_error if the text did not parse, in which case nothing changes
+      */
+      bool undo();
+      bool undo(std::ostream &output);
+
+      // Redoes the last change that was undone, or returns false if there is none
+      bool redo();
+      bool redo(std::ostream &output);
+
+      bool canUndo() const;
+      bool canRedo() const;
+
+      // Sets how many bytes the undo and redo history may use (1 MiB unless set), forgetting the oldest changes if it is larger
+      void setHistoryLimit(uint64_t bytes);
+
+      /**
+      * @brief Compares the profiles of this parser with those of 'other', rule by rule
+      *
+      * @details
+      * Profiles are matched by name (subprofiles and hats within the profiles they belong to), and rules are matched by
+      * the hash of their content, so changes to whitespace, comments or positions are not reported.
+      * Profiles with the same hash are skipped without looking at their rules.
+      * The rules of a changed profile are compared with Myers' algorithm, which takes time linear in the number of rules
+      * times the number of changes, and finds the fewest rules to add and remove.
+      *
+      * The returned changes point into both parsers, and stay valid until either parser is changed.
+      *
+      * @param other the newer state, such as a copy of this parser that was changed, or a parser of another file
+      *
+      * @returns the profiles that were added, removed or modified
+      */
+      std::vector<ProfileChange> diff(const Parser &other) const;
+
       /**
       * @brief Attempts to parse profile from a user-supplied string, and replace this profile with it
       *
@@ -62,7 +190,7 @@ namespace AppArmor {
       *
       * The following things would not change:
       *   - output of getPath()
-      *   - old_file_contents (private variable)
+      *   - the original text of 'file_contents', which cancelChanges() returns to
       *
       * If the string does not parse successfully, there should be no changes.
       *
@@ -75,10 +203,24 @@ namespace AppArmor {
       /**
       * @brief Returns whether this class has staged change to the AppArmor profile, which are not saved
       *
+      * @details
+      * Changes to the profiles are found by comparing getHash() with its value when the file was loaded or saved.
+      * Only if those are equal is the text compared, to find changes to whitespace, comments or text outside of the profiles.
+      *
       * @returns boolean, true if there are unsaved changes to the AppArmor profile
       */
       bool hasChanges();
 
+      /**
+      * @brief Returns a hash of every profile in this file (see ProfileRule::getHash()) and of the text outside of them
+      *
+      * @details
+      * The hash ignores positions, whitespace, comments outside of the profiles and the order of the profiles,
+      * so it can be used as a cache key or to check whether two files contain the same policy.
+      * It is kept up to date as the file is changed, without hashing the unchanged profiles again.
+      */
+      uint64_t getHash() const;
+
       /**
       * @brief Save changes to AppArmor profile, loading them into the kernel
       *
@@ -86,6 +228,8 @@ namespace AppArmor {
       * This method call 'pkexec aa-replace' to save and load profile changes to the kernel.
       * aa-replace is a binary we created that does two things: it first overwrites a file with the current profile data,
       * then it calls 'apparmor_parser -r' to replace the profile in the kernel.
+      * The profile data is streamed to the standard input of aa-replace piece by piece, so its size is not limited by the
+      * maximum length of a command-line argument.
       *
       * @returns int, the exit status of aa-replace. This should be zero if and only if there was no error.
       */
@@ -97,19 +241,165 @@ namespace AppArmor {
       explicit operator std::string() const;
 
     private:
+      friend class Transaction;
+
       void update_from_file_contents();
-      void update_from_stream(std::istream &stream);
+      void update_from_lexer(Lexer &lexer);
+
       void initializeProfileList(const std::shared_ptr<AppArmor::Tree::ParseTree> &ast);
 
-      // Checks whether a given Profile is in the profile_list
+      // Checks whether a given Profile is in the profile_list, and returns its position in the list
       // Throws an exception if it is not
-      void checkProfileValid(Profile &profile);
+      std::list<Profile>::iterator checkProfileValid(const Profile &profile);
+
+      // Checks whether a given rule is in 'profile' (which must be in the profile_list), and returns this parser's own copy of it
+      // Throws an exception if it is not
+      const RuleNode &checkRuleValid(const Profile &profile, const RuleNode &rule) const;
+
+      // Gives a profile and its rules new handles and adds them to the indexes below
+      // Also hashes the profile and its rules, and adds the profile's hash to 'profiles_hash'
+      void index_profile(std::list<Profile>::iterator profile);
+
+      // Adds a profile and its rules to the indexes below under the handles they already have, without hashing them
+      void index_handles(std::list<Profile>::iterator profile);
+
+      // Removes a profile and its rules from the indexes below
+      void unindex_profile(const Profile &profile);
+
+      // Returns the text of a profile in this parser, which is copied into 'storage' only if it is not stored in one piece
+      std::string_view profile_text(const Profile &profile, std::string &storage) const;
+
+      // Replaces 'length' characters at 'pos' with 'text', then writes the new contents to 'output' and updates the profiles
+      // If the change is inside 'profile', only that profile is parsed again and the profiles after it are moved
+      void splice(std::list<Profile>::iterator profile, uint64_t pos, uint64_t length, const std::string &text, std::ostream &output);
+
+      // Updates the profiles after 'splices' turned 'previous_contents' into 'file_contents'
+      // If every splice is inside 'profile' (or inside the profile containing the first splice, if 'profile' is the end of the list),
+      // only that profile is parsed again. 'file_contents' is put back if the result does not parse.
+      void update_after_splices(std::list<Profile>::iterator profile, const PieceTable &previous_contents,
+                                const std::vector<Patch::Splice> &splices);
+
+      // Adds the inverse of a change to the undo history, and forgets the changes that were undone
+      // Does nothing if there are no splices
+      void record_change(const PieceTable &previous_contents, const std::vector<Patch::Splice> &splices);
+
+      // Forgets the oldest changes until the history fits in 'history_limit'
+      void trim_history();
+
+      // Applies the last step of 'from', and adds its inverse to 'to' (see undo() and redo())
+      using HistoryStep = std::vector<Patch::Splice>;
+      bool step_history(std::deque<HistoryStep> &from, std::deque<HistoryStep> &to, std::ostream &output);
+
+      // Writes the result of a change to 'output', as the whole file or as a patch of 'previous_contents' (see OutputMode)
+      void write_output(std::ostream &output, const PieceTable &previous_contents, std::vector<Patch::Splice> splices) const;
+
+      // Parses the text of a single profile again, after its length changed by 'delta' characters
+      // Returns false if the profile could not be parsed on its own, in which case the whole file should be parsed
+      bool reparse_profile(std::list<Profile>::iterator profile, int64_t delta);
 
       std::string path;
-      std::string file_contents;
-      std::string old_file_contents;
+
+      // The current contents, stored as changes on top of the contents as of the last load or save
+      PieceTable file_contents;
 
       std::list<Profile> profile_list; 
+
+      // Where the rule with each handle is stored, and which profile it belongs to
+      struct RuleEntry {
+        uint64_t profile_handle;
+        const RuleNode *rule;
+      };
+
+      std::unordered_map<uint64_t, std::list<Profile>::iterator> profile_index;
+      std::unordered_map<uint64_t, RuleEntry> rule_index;
+
+      // The sum of the hashes of every profile, so that one profile can be replaced without hashing the others
+      uint64_t profiles_hash = 0;
+
+      // A hash of the text outside of the profiles, such as variables and includes, without its comments
+      uint64_t outside_hash = 0;
+
+      // The value of getHash() when the file was last loaded or saved
+      uint64_t saved_hash = 0;
+
+      // Counts every change to the text and profiles, so a Transaction can tell whether its positions are outdated
+      uint64_t change_count = 0;
+
+      OutputMode output_mode = OutputMode::Contents;
+
+      // The splices that undo (or redo) each change, with the most recent change last
+      std::deque<HistoryStep> undo_history;
+      std::deque<HistoryStep> redo_history;
+      uint64_t history_limit = 1 << 20;
+
+      // The number of bytes used by both histories, kept up to date as steps are added and forgotten
+      uint64_t history_size = 0;
+
+      SourceMap source_map;
+  };
+
+  // The outcome of parsing a single file with Parser::parseAll()
+  struct ParseResult {
+    std::string path;
+
+    // The parsed file, or std::nullopt if it could not be parsed
+    std::optional<Parser> parser;
+
+    // Describes why the file could not be parsed, or is empty on success
+    std::string error;
+  };
+
+  /**
+  * @brief A batch of changes to a Parser, which are applied together
+  *
+  * @details
+  * Each change is checked and converted to a text replacement when it is queued, using the positions of the parser's current profiles.
+  * commit() applies every replacement to the file contents, parses the result once, and writes the new contents to 'output' once.
+  * If the changes overlap or the result does not parse, commit() throws and the parser is left exactly as it was before.
+  * Committing a transaction with no changes does nothing, so it writes no output and leaves the undo and redo history as they were.
+  *
+  * The parser should not be changed by other means while a transaction is open, since the queued positions would then be outdated.
+  */
+  class Transaction {
+    public:
+      explicit Transaction(Parser &parser);
+
+      template<RuleDerived RuleType>
+      void removeRule(Profile &profile, RuleType &rule);
+
+      template<RuleDerived RuleType>
+      void addRule(Profile &profile, const RuleType &newRule);
+
+      template<RuleDerived RuleType>
+      void editRule(Profile &profile, RuleType &oldRule, const RuleType &newRule);
+
+      // Returns the number of changes that are queued
+      size_t size() const;
+
+      /**
+      * @brief Applies every queued change to the parser, and empties this transaction
+      *
+      * @throws std::domain_error if two changes replace the same text, or if the parser was changed since the first change was queued
+      * @throws std::runtime_error if the changed profile did not parse correctly
+      */
+      void commit();
+      void commit(std::ostream &output);
+
+      // Discards every queued change
+      void rollback();
+
+    private:
+      // Replaces 'length' characters at 'pos' of the original text with 'text'
+      using Splice = Patch::Splice;
+
+      // Queues a change, noting the parser's change count when it is the first one
+      void queue(Splice splice);
+
+      Parser &parser;
+      std::vector<Splice> splices;
+
+      // The parser's change count when the first queued change was made
+      uint64_t change_count = 0;
   };
 } // namespace AppArmor
 
@@ -0,0 +1,165 @@
+#include "content_hash.hh"
+
+#include <cctype>
+#include <stdexcept>
+
+void AppArmor::ContentHash::add(std::string_view data)
+{
+  add(static_cast<uint64_t>(data.size()));
+  addBytes(data);
+}
+
+void AppArmor::ContentHash::addBytes(std::string_view data)
+{
+  for(const char &ch : data) {
+    addByte(static_cast<uint8_t>(ch));
+  }
+}
+
+void AppArmor::ContentHash::add(uint64_t value)
+{
+  for(int i = 0; i < 8; i++) {
+    addByte(static_cast<uint8_t>(value >> (i * 8)));
+  }
+}
+
+void AppArmor::ContentHash::addText(std::string_view text)
+{
+  bool pending_space = false;
+  bool started       = false;
+
+  for(const char &ch : text) {
+    if(std::isspace(static_cast<unsigned char>(ch)) != 0) {
+      pending_space = started;
+      continue;
+    }
+
+    if(pending_space) {
+      addByte(' ');
+      pending_space = false;
+    }
+
+    addByte(static_cast<uint8_t>(ch));
+    started = true;
+  }
+
+  // Ends the text, so that it cannot run into whatever is added next
+  addByte(0);
+}
+
+uint64_t AppArmor::ContentHash::value() const
+{
+  auto result = mix(state);
+  return (result == 0) ? 1 : result;
+}
+
+uint64_t AppArmor::ContentHash::mix(uint64_t value)
+{
+  // Finalizer of splitmix64
+  value ^= value >> 30U;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27U;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31U;
+  return value;
+}
+
+void AppArmor::ContentHash::addByte(uint8_t byte)
+{
+  state ^= byte;
+  state *= FNV_PRIME;
+}
+
+AppArmor::ProfileHasher::ProfileHasher(std::string_view text, uint64_t offset)
+  : text{text},
+    offset{offset}
+{   }
+
+AppArmor::ContentHash AppArmor::ProfileHasher::header(const Tree::ProfileRule &profile) const
+{
+  ContentHash result;
+  result.addText(textOf(profile.getStartPosition(), profile.getRuleStartPosition()));
+  return result;
+}
+
+uint64_t AppArmor::ProfileHasher::hash(const Tree::ProfileRule &profile) const
+{
+  ContentHash result = header(profile);
+  profile.visit([&](const auto &rule) {
+    result.add(hash(rule));
+  });
+
+  return result.value();
+}
+
+uint64_t AppArmor::ProfileHasher::hash(const Tree::FileRule &rule) const
+{
+  const auto &mode = rule.getFilemode();
+  uint64_t mode_bits = static_cast<uint64_t>(mode.getRead()) |
+                       static_cast<uint64_t>(mode.getWrite()) << 1U |
+                       static_cast<uint64_t>(mode.getAppend()) << 2U |
+                       static_cast<uint64_t>(mode.getMemoryMap()) << 3U |
+                       static_cast<uint64_t>(mode.getLink()) << 4U |
+                       static_cast<uint64_t>(mode.getLock()) << 5U |
+                       static_cast<uint64_t>(mode.getTransition()) << 8U;
+
+  ContentHash result = begin(rule);
+  result.add(rule.getFilename());
+  result.add(mode_bits);
+  result.add(rule.getExecTarget());
+  return result.value();
+}
+
+uint64_t AppArmor::ProfileHasher::hash(const Tree::AbstractionRule &rule) const
+{
+  ContentHash result = begin(rule);
+  result.add(rule.getPath());
+  result.add(static_cast<uint64_t>(rule.isRelative()) | static_cast<uint64_t>(rule.isIfExists()) << 1U);
+  return result.value();
+}
+
+uint64_t AppArmor::ProfileHasher::hash(const Tree::RuleList &rule) const
+{
+  ContentHash result = begin(rule);
+  rule.visit([&](const auto &nested) {
+    result.add(hash(nested));
+  });
+
+  return result.value();
+}
+
+uint64_t AppArmor::ProfileHasher::hash(const Tree::GenericRule &rule) const
+{
+  ContentHash result = begin(rule);
+  result.add(static_cast<uint64_t>(rule.getKind()));
+  result.addText(textOf(rule.getStartPosition(), rule.getEndPosition()));
+  return result.value();
+}
+
+uint64_t AppArmor::ProfileHasher::hash(const Tree::RuleNode &rule) const
+{
+  ContentHash result = begin(rule);
+  result.addText(textOf(rule.getStartPosition(), rule.getEndPosition()));
+  return result.value();
+}
+
+AppArmor::ContentHash AppArmor::ProfileHasher::begin(const Tree::RuleNode &rule)
+{
+  const auto &prefix = rule.getPrefix();
+
+  ContentHash result;
+  result.add(static_cast<uint64_t>(rule.getRuleKind()));
+  result.add(static_cast<uint64_t>(prefix.getAudit()) |
+             static_cast<uint64_t>(prefix.getShouldDeny()) << 1U |
+             static_cast<uint64_t>(prefix.getOwner()) << 2U);
+  return result;
+}
+
+std::string_view AppArmor::ProfileHasher::textOf(uint64_t start, uint64_t end) const
+{
+  if(start < offset || end < start || end - offset > text.size()) {
+    throw std::out_of_range("hashed rule is outside of the given text");
+  }
+
+  return text.substr(start - offset, end - start);
+}
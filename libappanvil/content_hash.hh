@@ -0,0 +1,81 @@
+#ifndef CONTENT_HASH_HH
+#define CONTENT_HASH_HH
+
+#include "tree/ProfileRule.hh"
+
+#include <cstdint>
+#include <string_view>
+
+namespace AppArmor {
+  /**
+  * @brief A 64-bit hash (FNV-1a, with a final mix) that is built up from strings and numbers
+  *
+  * @details
+  * The value is never 0, so 0 can be used to mean that something was not hashed.
+  */
+  class ContentHash {
+    public:
+      // Adds the length and bytes of 'data'
+      void add(std::string_view data);
+
+      // Adds the bytes of 'data' without its length, so text added in several parts hashes the same as the whole text
+      void addBytes(std::string_view data);
+
+      // Adds a number, such as a flag or the hash of a nested rule
+      void add(uint64_t value);
+
+      // Adds source text, treating every run of whitespace as a single space and ignoring whitespace at either end
+      void addText(std::string_view text);
+
+      uint64_t value() const;
+
+      // Spreads the bits of 'value', so that sums of mixed values are well distributed
+      static uint64_t mix(uint64_t value);
+
+    private:
+      void addByte(uint8_t byte);
+
+      static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+      static constexpr uint64_t FNV_PRIME        = 1099511628211ULL;
+
+      uint64_t state = FNV_OFFSET_BASIS;
+  };
+
+  /**
+  * @brief Hashes profiles and rules by their content, ignoring their positions and the amount of whitespace between tokens
+  *
+  * @details
+  * Rules with a detailed model (file rules and abstractions) are hashed by their fields.
+  * Other rules (such as network or link rules) are hashed by their kind, prefix and source text.
+  * A profile is hashed by the text before its rules (name, attachment and flags) and the hash of each rule, in order.
+  */
+  class ProfileHasher {
+    public:
+      // 'text' is the text of the file starting at character position 'offset', and must contain every rule that is hashed
+      ProfileHasher(std::string_view text, uint64_t offset);
+
+      // Returns a hash of the text before the rules of a profile, to which the hash of each rule can be added
+      ContentHash header(const Tree::ProfileRule &profile) const;
+
+      uint64_t hash(const Tree::ProfileRule &profile) const;
+      uint64_t hash(const Tree::FileRule &rule) const;
+      uint64_t hash(const Tree::AbstractionRule &rule) const;
+      uint64_t hash(const Tree::RuleList &rule) const;
+      uint64_t hash(const Tree::GenericRule &rule) const;
+
+      // Used for rules that are only hashed by their text, such as LinkRule and AllRule
+      uint64_t hash(const Tree::RuleNode &rule) const;
+
+    private:
+      // Returns a hash that already contains the kind and prefix of 'rule'
+      static ContentHash begin(const Tree::RuleNode &rule);
+
+      // Returns the text between two character positions of the file
+      std::string_view textOf(uint64_t start, uint64_t end) const;
+
+      std::string_view text;
+      uint64_t offset;
+  };
+} // namespace AppArmor
+
+#endif // CONTENT_HASH_HH
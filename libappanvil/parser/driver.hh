@@ -2,9 +2,12 @@
 #define DRIVER_HH
 
 #include "parser.h"
+#include "source_map.hh"
+#include "string_pool.hh"
 #include "tree/ParseTree.hh"
 #include "tree/TreeNode.hh"
 #include <string>
+#include <string_view>
 
 class Driver
 {
@@ -17,6 +20,40 @@ class Driver
     // Lexer fields
     YYLTYPE yylloc = {.first_pos = 0, .last_pos = 0};
     uint64_t current_lineno = 0;
+
+    // Line breaks seen by the lexer, used to convert positions to line/column numbers
+    AppArmor::SourceMap source_map;
+
+    // Text of the tokens returned by the lexer, which lives as long as the driver
+    StringPool strings;
+
+    // Processes the quotes and escape sequences of an ID, and returns its pooled text
+    std::string_view processid(const char *text, int len)
+    {
+      // Most IDs have no quotes or escape sequences, so their text can be interned without processing
+      if(find_escape_or_quote(text, len) == nullptr) {
+        return intern(text, len);
+      }
+
+      scratch.resize(len + 1);
+      int length = ::processid(scratch.data(), text, len);
+      if(length < 0) {
+        yyerror(_("Failed to process ID\n"));
+        return {};
+      }
+
+      return strings.intern(std::string_view(scratch.data(), length));
+    }
+
+    // Returns the pooled copy of some token text
+    std::string_view intern(const char *text, int len)
+    {
+      return strings.intern(std::string_view(text, len));
+    }
+
+  private:
+    // Reused by processid(), so that processing an ID does not allocate
+    std::string scratch;
 };
 
 #endif // DRIVER_HH
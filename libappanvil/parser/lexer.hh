@@ -5,7 +5,12 @@
 #include <FlexLexer.h>
 #endif
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "common.hh"
 #include "driver.hh"
@@ -21,6 +26,18 @@ class Lexer : public yyFlexLexer {
     Lexer(std::istream& arg_yyin, std::ostream& arg_yyout)
       : yyFlexLexer(arg_yyin, arg_yyout) {}
 
+    // Scans a contiguous buffer directly, without going through a std::istream
+    // The buffer must outlive the lexer
+    explicit Lexer(std::string_view buffer)
+      : Lexer(std::vector<std::string_view>{buffer}) {}
+
+    // Scans a sequence of buffers (such as the pieces of an AppArmor::PieceTable) as if they were one
+    // The buffers must outlive the lexer
+    explicit Lexer(std::vector<std::string_view> buffers)
+      : yyFlexLexer(nullptr, &std::cerr),
+        buffers{std::move(buffers)},
+        use_buffer{true} {}
+
     virtual symbol_type yylex(Driver& driver);
 
     [[deprecated("This was added to avoid a compiler warning. Recommended to use the other constructor")]]
@@ -29,6 +46,37 @@ class Lexer : public yyFlexLexer {
       Driver driver;
       return yylex(driver).value.as<int>();
     }
+
+  protected:
+    // Flex calls this whenever it needs more input
+    // When scanning a buffer, copy the largest block flex will accept instead of reading from 'yyin'
+    int LexerInput(char* buf, int max_size) override
+    {
+      if(!use_buffer) {
+        return yyFlexLexer::LexerInput(buf, max_size);
+      }
+
+      // Copy from as many buffers as will fit
+      int copied = 0;
+      while(copied < max_size && next_buffer < buffers.size()) {
+        auto &buffer = buffers[next_buffer];
+        auto length = std::min(buffer.size(), static_cast<size_t>(max_size - copied));
+        std::memcpy(buf + copied, buffer.data(), length); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        buffer.remove_prefix(length);
+        copied += static_cast<int>(length);
+
+        if(buffer.empty()) {
+          next_buffer++;
+        }
+      }
+
+      return copied;
+    }
+
+  private:
+    std::vector<std::string_view> buffers;
+    size_t next_buffer = 0;
+    bool use_buffer = false;
 };
 
 // Define the lexer prototype
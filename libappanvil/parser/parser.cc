@@ -22,18 +22,21 @@
 
 #include <cassert>
 #include <cstring>
+#include <string_view>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "lib.h"
 #include "common.hh"
 #include "lexer.hh"
+#include "perfect_hash.hh"
 
 // NOLINTBEGIN
-struct keyword_table {
-	const char *keyword;
-	unsigned int token;
-};
-
-static struct keyword_table keyword_table[] = {
+/* Both tables are perfect hashes built at compile time, so a lookup is a
+ * single hash and at most one string comparison */
+static constexpr PerfectHash::Entry keyword_entries[] = {
 	/* network */
 	{"network",			token::TOK_NETWORK},
 	{"unix",			token::TOK_UNIX},
@@ -80,12 +83,11 @@ static struct keyword_table keyword_table[] = {
 	{"readby",			token::TOK_READBY},
 	{"abi",				token::TOK_ABI},
 	{"userns",			token::TOK_USERNS},
-
-	/* terminate */
-	{NULL, 0}
 };
 
-static struct keyword_table rlimit_table[] = {
+static constexpr PerfectHash::Table keyword_table(keyword_entries);
+
+static constexpr PerfectHash::Entry rlimit_entries[] = {
 	{"cpu",			RLIMIT_CPU},
 	{"fsize",		RLIMIT_FSIZE},
 	{"data",		RLIMIT_DATA},
@@ -111,41 +113,63 @@ static struct keyword_table rlimit_table[] = {
 #ifdef RLIMIT_RTTIME
 	{"rttime",		RLIMIT_RTTIME},
 #endif
-	/* terminate */
-	{NULL, 0}
 };
 
+static constexpr PerfectHash::Table rlimit_table(rlimit_entries);
+
 /* for alpha matches, check for keywords */
-static int get_table_token(struct keyword_table *table,
-			   const char *keyword)
+int get_keyword_token(const char *keyword, int len)
 {
-	int i;
-	for (i = 0; table[i].keyword; i++) {
-		if (strcmp(keyword, table[i].keyword) == 0) {
-			return table[i].token;
-		}
-	}
-	return -1;
+	return keyword_table.lookup(std::string_view(keyword, len));
 }
 
-/* for alpha matches, check for keywords */
-int get_keyword_token(const char *keyword)
+int get_rlimit(const char *name)
 {
-	return get_table_token(keyword_table, keyword);
+	return rlimit_table.lookup(name);
 }
 
-int get_rlimit(const char *name)
+/* return the first backslash or double quote in 'string', or NULL if
+ * there is none.  IDs rarely contain either, so check 16 bytes at a time
+ * where SSE2 is available */
+const char *find_escape_or_quote(const char *string, int len)
 {
-	return get_table_token(rlimit_table, name);
+	const char *end = string + len;
+
+#ifdef __SSE2__
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i quote = _mm_set1_epi8('"');
+
+	for (; end - string >= 16; string += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *) string);
+		__m128i found = _mm_or_si128(_mm_cmpeq_epi8(block, backslash),
+					     _mm_cmpeq_epi8(block, quote));
+		int mask = _mm_movemask_epi8(found);
+		if (mask)
+			return string + __builtin_ctz(mask);
+	}
+#endif
+
+	for (; string < end; string++) {
+		if (*string == '\\' || *string == '"')
+			return string;
+	}
+	return NULL;
 }
 
-char *processunquoted(const char *string, int len)
+/* copy 'string' into 'buffer', substituting escaped characters for the
+ * real thing.  'buffer' must have room for len + 1 characters.  Returns
+ * the length of the result */
+int processunquoted(char *buffer, const char *string, int len)
 {
-	char *buffer, *s;
+	char *s = buffer;
 
-	s = buffer = (char *) malloc(len + 1);
-	if (!buffer)
-		return NULL;
+	/* everything before the first escape sequence is copied as is */
+	const char *escape = find_escape_or_quote(string, len);
+	int prefix = escape ? escape - string : len;
+	memcpy(s, string, prefix);
+	s += prefix;
+	string += prefix;
+	len -= prefix;
 
 	while (len > 0) {
 		const char *pos = string + 1;
@@ -177,34 +201,35 @@ char *processunquoted(const char *string, int len)
 	}
 	*s = 0;
 
-	return buffer;
+	return s - buffer;
 }
 
 /* rewrite a quoted string substituting escaped characters for the
- * real thing.  Strip the quotes around the string */
-char *processquoted(const char *string, int len)
+ * real thing.  Strip the quotes around the string.  Returns -1 if the
+ * closing quote is missing */
+int processquoted(char *buffer, const char *string, int len)
 {
 	/* skip leading " and eat trailing " */
 	if (*string == '"') {
 		if (string[len -1] != '"')
-			return NULL;
+			return -1;
 		len -= 2;
 		if (len < 0)	/* start and end point to same quote */
 			len = 0;
-		return processunquoted(string + 1, len);
+		return processunquoted(buffer, string + 1, len);
 	}
 
 	/* no quotes? treat as unquoted */
-	return processunquoted(string, len);
+	return processunquoted(buffer, string, len);
 }
 
-char *processid(const char *string, int len)
+int processid(char *buffer, const char *string, int len)
 {
 	/* lexer should never call this fn if len <= 0 */
 	assert(len > 0);
 
 	if (*string == '"')
-		return processquoted(string, len);
-	return processunquoted(string, len);
+		return processquoted(buffer, string, len);
+	return processunquoted(buffer, string, len);
 }
 // NOLINTEND
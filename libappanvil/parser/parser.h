@@ -188,10 +188,13 @@ enum ExecMode {
 extern int yyparse(void);
 extern void yyerror(const char *msg, ...);
 
-extern char *processid(const char *string, int len);
-extern char *processquoted(const char *string, int len);
-extern char *processunquoted(const char *string, int len);
-extern int get_keyword_token(const char *keyword);
+/* write the processed ID into 'buffer', which needs room for len + 1
+ * characters, and return its length or -1 on error */
+extern int processid(char *buffer, const char *string, int len);
+extern int processquoted(char *buffer, const char *string, int len);
+extern int processunquoted(char *buffer, const char *string, int len);
+extern const char *find_escape_or_quote(const char *string, int len);
+extern int get_keyword_token(const char *keyword, int len);
 
 typedef struct YYLTYPE
 {
@@ -19,6 +19,7 @@
  */
 
 #define YYERROR_VERBOSE 1
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
@@ -158,11 +159,14 @@ while (0)
 %code requires {
   #include <memory>
   #include <sstream>
+  #include <string_view>
+  #include <utility>
 
   #include "parser.h"
   #include "tree/AbstractionRule.hh"
   #include "tree/AliasNode.hh"
   #include "tree/FileRule.hh"
+  #include "tree/GenericRule.hh"
   #include "tree/LinkRule.hh"
   #include "tree/ParseTree.hh"
   #include "tree/ProfileRule.hh"
@@ -187,6 +191,13 @@ while (0)
   #undef yylex
   #define yylex scanner.yylex
   using namespace AppArmor::Tree;
+
+  // Returns where an optional symbol (such as a rule's prefix) starts if it was written, or 'start' otherwise
+  // An empty symbol has an empty location, at the end of the symbol before it
+  static uint64_t optional_start(const YYLTYPE &optional, uint64_t start)
+  {
+    return (optional.first_pos != optional.last_pos) ? optional.first_pos : start;
+  }
 }
 
 %type <std::shared_ptr<ParseTree>> 				tree
@@ -210,7 +221,7 @@ while (0)
 %type <RuleNode> userns_rule
 %type <RuleNode> change_profile
 %type <RuleNode> capability
-%type <RuleNode> hat
+%type <ProfileRule> hat
 %type <RuleNode> cond_rule
 %type <LinkRule> link_rule
 %type <FileRule> file_rule
@@ -218,14 +229,14 @@ while (0)
 %type <FileRule> file_rule_tail
 %type <AllRule>	 all_rule
 
-%type <std::string> TOK_ID
-%type <std::string>	TOK_CONDID
-%type <std::string>	TOK_CONDLISTID
-%type <std::string>	TOK_ALIAS
-%type <std::string> TOK_MODE
-%type <std::string> TOK_SET_VAR
-%type <std::string> TOK_BOOL_VAR
-%type <std::string>	TOK_VALUE
+%type <std::string_view> TOK_ID
+%type <std::string_view>	TOK_CONDID
+%type <std::string_view>	TOK_CONDLISTID
+%type <std::string_view>	TOK_ALIAS
+%type <std::string_view> TOK_MODE
+%type <std::string_view> TOK_SET_VAR
+%type <std::string_view> TOK_BOOL_VAR
+%type <std::string_view>	TOK_VALUE
 
 %type <bool> opt_subset_flag
 %type <bool> opt_audit_flag
@@ -237,11 +248,11 @@ while (0)
 %type <bool> opt_file
 
 %type <FileMode> file_mode
-%type <std::string>	id_or_var
-%type <std::string>	opt_id_or_var
-%type <std::string>	opt_id
-%type <std::string>	opt_target
-%type <std::string>	opt_named_transition
+%type <std::string_view>	id_or_var
+%type <std::string_view>	opt_id_or_var
+%type <std::string_view>	opt_id
+%type <std::string_view>	opt_target
+%type <std::string_view>	opt_named_transition
 %%
 
 
@@ -252,7 +263,7 @@ tree: preamble profilelist {
 						   };
 
 profilelist:					 { $$ = std::make_shared<std::list<ProfileRule>>(); }
-		   | profilelist profile { $$ = $1; $$->push_back($2); }
+		   | profilelist profile { $$ = std::move($1); $$->push_back(std::move($2)); }
 
 opt_profile_flag:				{ $$ = PROFILE_MODE_EMPTY; }
 				| TOK_PROFILE	{ $$ = PROFILE_MODE_START; }
@@ -269,23 +280,32 @@ profile_base: TOK_ID opt_id_or_var opt_cond_list flags TOK_OPEN rules TOK_CLOSE
 		$6.setStartPosition(@6.first_pos);
 		$6.setStopPosition(@6.last_pos);
 
-		$$ = ProfileRule($1, $6);
+		$$ = ProfileRule(std::string($1), std::move($6));
 	}
 
-profile: opt_profile_flag profile_base { $$ = $2; }
+profile: opt_profile_flag profile_base {
+		$$ = std::move($2);
+		$$.setPosition($1 ? @1.first_pos : @2.first_pos, @2.last_pos);
+	}
 
-local_profile: TOK_PROFILE profile_base { $$ = $2; }
+local_profile: TOK_PROFILE profile_base {
+		$$ = std::move($2);
+		$$.setPosition(@1.first_pos, @2.last_pos);
+	}
 
-hat: hat_start profile_base
+hat: hat_start profile_base {
+		$$ = std::move($2);
+		$$.setPosition(@1.first_pos, @2.last_pos);
+	}
 
 preamble:					 	{ $$ = TreeNode(); }
-		| preamble alias	 	{ $$ = $1; $$.appendChild($2); }
-		| preamble varassign 	{ $$ = $1; /*$$.appendChild($2);*/ }
-		| preamble abi_rule	 	{ $$ = $1; $$.appendChild($2); }
-		| preamble abstraction	{ $$ = $1; /*$$.appendChild($2);*/ }
+		| preamble alias	 	{ $$ = std::move($1); $$.appendChild($2); }
+		| preamble varassign 	{ $$ = std::move($1); /*$$.appendChild($2);*/ }
+		| preamble abi_rule	 	{ $$ = std::move($1); $$.appendChild($2); }
+		| preamble abstraction	{ $$ = std::move($1); /*$$.appendChild($2);*/ }
 
 alias: TOK_ALIAS TOK_ID TOK_ARROW TOK_ID TOK_END_OF_RULE {
-		$$ = AliasNode($2, $4);
+		$$ = AliasNode(std::string($2), std::string($4));
 	}
 
 varassign: TOK_SET_VAR TOK_EQUALS valuelist
@@ -298,7 +318,7 @@ valuelist: TOK_VALUE
 opt_flags:					{ $$ = false; }
 	| TOK_CONDID TOK_EQUALS	{ 
 							  if($1 != "flags") {
-								yyerror("expected flags= got %s=", $1.c_str());
+								yyerror("expected flags= got %s=", std::string($1).c_str());
 							  }
 							  $$ = true;
 							}
@@ -327,28 +347,32 @@ opt_perm_mode:				{$$ = false;}
 			 | TOK_ALLOW	{$$ = false;}
 			 | TOK_DENY		{$$ = true;}
 
-opt_prefix: opt_audit_flag opt_perm_mode opt_owner_flag {$$ = PrefixNode($1, $2, $3);}
+// YYLLOC_DEFAULT would start the prefix at 'audit' even if it is empty, so start it at the first flag that was written
+opt_prefix: opt_audit_flag opt_perm_mode opt_owner_flag {
+		$$ = PrefixNode($1, $2, $3);
+		@$.first_pos = optional_start(@1, optional_start(@2, @3.first_pos));
+	}
 
 rules:												{$$ = RuleList(@0.last_pos);}
-	 | rules abi_rule								{$$ = $1;}
-	 | rules opt_prefix file_rule					{$$ = $1; $$.appendFileRule($2, $3);}
-	 | rules opt_prefix link_rule					{$$ = $1; $$.appendLinkRule($2, $3);}
-	 | rules opt_prefix TOK_OPEN rules TOK_CLOSE	{$$ = $1; $$.appendRuleList($2, $4);}
-	 | rules opt_prefix network_rule				{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix mnt_rule					{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix dbus_rule					{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix signal_rule					{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix ptrace_rule					{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix unix_rule					{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix userns_rule					{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix change_profile				{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules opt_prefix capability					{$$ = $1; /* $$.appendChildren({$2, $3}); */}
-	 | rules all_rule								{$$ = $1; /* $$.appendChild({$2}); */}
-	 | rules hat									{$$ = $1; /* $$.appendChild($2); */}
-	 | rules local_profile							{$$ = $1; $$.appendSubprofile($2);}
-	 | rules cond_rule								{$$ = $1; /* $$.appendChild($2); */}
-	 | rules abstraction							{$$ = $1; $$.appendAbstraction($2);}
-	 | rules TOK_SET TOK_RLIMIT TOK_ID TOK_LE TOK_VALUE opt_id TOK_END_OF_RULE	{$$ = $1;}
+	 | rules abi_rule								{$$ = std::move($1); $$.appendGenericRule(PrefixNode(), GenericRule(GenericRule::Kind::Abi, @2.first_pos, @2.last_pos));}
+	 | rules opt_prefix file_rule					{$$ = std::move($1); $3.setStartPosition(optional_start(@2, $3.getStartPosition())); $$.appendFileRule($2, std::move($3));}
+	 | rules opt_prefix link_rule					{$$ = std::move($1); $3.setStartPosition(optional_start(@2, $3.getStartPosition())); $$.appendLinkRule($2, std::move($3));}
+	 | rules opt_prefix TOK_OPEN rules TOK_CLOSE	{$$ = std::move($1); $4.setStartPosition(optional_start(@2, @3.first_pos)); $4.setStopPosition(@5.last_pos); $$.appendRuleList($2, std::move($4));}
+	 | rules opt_prefix network_rule				{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Network, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix mnt_rule					{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Mount, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix dbus_rule					{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Dbus, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix signal_rule					{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Signal, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix ptrace_rule					{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Ptrace, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix unix_rule					{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Unix, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix userns_rule					{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Userns, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix change_profile				{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::ChangeProfile, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules opt_prefix capability					{$$ = std::move($1); $$.appendGenericRule($2, GenericRule(GenericRule::Kind::Capability, optional_start(@2, @3.first_pos), @3.last_pos));}
+	 | rules all_rule								{$$ = std::move($1); $$.appendAllRule(std::move($2));}
+	 | rules hat									{$$ = std::move($1); $$.appendHat(std::move($2));}
+	 | rules local_profile							{$$ = std::move($1); $$.appendSubprofile(std::move($2));}
+	 | rules cond_rule								{$$ = std::move($1); $$.appendGenericRule(PrefixNode(), GenericRule(GenericRule::Kind::Conditional, @2.first_pos, @2.last_pos));}
+	 | rules abstraction							{$$ = std::move($1); $$.appendAbstraction(std::move($2));}
+	 | rules TOK_SET TOK_RLIMIT TOK_ID TOK_LE TOK_VALUE opt_id TOK_END_OF_RULE	{$$ = std::move($1); $$.appendGenericRule(PrefixNode(), GenericRule(GenericRule::Kind::Rlimit, @2.first_pos, @8.last_pos));}
 
 cond_rule: TOK_IF expr TOK_OPEN rules TOK_CLOSE
 		 | TOK_IF expr TOK_OPEN rules TOK_CLOSE TOK_ELSE TOK_OPEN rules TOK_CLOSE
@@ -368,13 +392,13 @@ opt_target: /* nothing */		{ $$ = ""; }
 opt_named_transition: /* nothing */			{$$ = "";}
 					| TOK_ARROW id_or_var	{$$ = $2;}
 
-abi_rule: TOK_ABI TOK_ID 	TOK_END_OF_RULE	{$$ = TreeNode($2);}
-		| TOK_ABI TOK_VALUE TOK_END_OF_RULE	{$$ = TreeNode($2);}
+abi_rule: TOK_ABI TOK_ID 	TOK_END_OF_RULE	{$$ = TreeNode(std::string($2));}
+		| TOK_ABI TOK_VALUE TOK_END_OF_RULE	{$$ = TreeNode(std::string($2));}
 
-abstraction: TOK_INCLUDE		   TOK_ID 	 {$$ = AbstractionRule(@1.first_pos, @2.last_pos, $2, false);}
-		   | TOK_INCLUDE		   TOK_VALUE {$$ = AbstractionRule(@1.first_pos, @2.last_pos, $2, false);}
-		   | TOK_INCLUDE_IF_EXISTS TOK_ID 	 {$$ = AbstractionRule(@1.first_pos, @2.last_pos, $2, true);}
-		   | TOK_INCLUDE_IF_EXISTS TOK_VALUE {$$ = AbstractionRule(@1.first_pos, @2.last_pos, $2, true);}
+abstraction: TOK_INCLUDE		   TOK_ID 	 {$$ = AbstractionRule(@1.first_pos, @2.last_pos, std::string($2), false);}
+		   | TOK_INCLUDE		   TOK_VALUE {$$ = AbstractionRule(@1.first_pos, @2.last_pos, std::string($2), false);}
+		   | TOK_INCLUDE_IF_EXISTS TOK_ID 	 {$$ = AbstractionRule(@1.first_pos, @2.last_pos, std::string($2), true);}
+		   | TOK_INCLUDE_IF_EXISTS TOK_VALUE {$$ = AbstractionRule(@1.first_pos, @2.last_pos, std::string($2), true);}
 
 opt_exec_mode:				{ $$ = EXEC_MODE_EMPTY; }
 			 | TOK_UNSAFE	{ $$ = EXEC_MODE_UNSAFE; }
@@ -384,16 +408,16 @@ opt_file:			{ $$ = 0; }
 		| TOK_FILE  { $$ = 1; }
 
 // Should utilize the deleted get_mode() from parser.h instead of yylval mode
-frule: id_or_var file_mode opt_named_transition TOK_END_OF_RULE					{$$ = FileRule(@1.first_pos, @4.last_pos, $1, $2, $3);}
+frule: id_or_var file_mode opt_named_transition TOK_END_OF_RULE					{$$ = FileRule(@1.first_pos, @4.last_pos, std::string($1), $2, std::string($3));}
 //	 | file_mode opt_subset_flag id_or_var opt_named_transition TOK_END_OF_RULE	{$$ = FileRule(@1.first_pos, @5.last_pos, $3, $1, $4, $2);}
 
 file_rule: TOK_FILE TOK_END_OF_RULE	{$$ = FileRule(@1.first_pos, @2.last_pos);}
-		 | opt_file file_rule_tail	{$$ = $2;}
+		 | opt_file file_rule_tail	{$$ = std::move($2); $$.setStartPosition(optional_start(@1, $$.getStartPosition()));}
 
-file_rule_tail: opt_exec_mode frule							{$$ = $2;}
-			  | opt_exec_mode id_or_var file_mode id_or_var	{$$ = FileRule(@1.first_pos, @4.last_pos, $2, $3, $4);}
+file_rule_tail: opt_exec_mode frule							{$$ = std::move($2); $$.setStartPosition(optional_start(@1, $$.getStartPosition()));}
+			  | opt_exec_mode id_or_var file_mode id_or_var	{$$ = FileRule(optional_start(@1, @2.first_pos), @4.last_pos, std::string($2), $3, std::string($4));}
 
-link_rule: TOK_LINK opt_subset_flag id_or_var TOK_ARROW id_or_var TOK_END_OF_RULE	{$$ = LinkRule(@1.first_pos, @6.last_pos, $2, $3, $5);}
+link_rule: TOK_LINK opt_subset_flag id_or_var TOK_ARROW id_or_var TOK_END_OF_RULE	{$$ = LinkRule(@1.first_pos, @6.last_pos, $2, std::string($3), std::string($5));}
 
 network_rule: TOK_NETWORK opt_net_perm               opt_conds opt_cond_list TOK_END_OF_RULE {$$ = RuleNode(@1.first_pos, @5.last_pos);}
 			| TOK_NETWORK opt_net_perm TOK_ID        opt_conds opt_cond_list TOK_END_OF_RULE {$$ = RuleNode(@1.first_pos, @6.last_pos);}
@@ -539,18 +563,20 @@ caps:
 
 void yyerror(const char *msg, ...)
 {
-	std::stringstream out;
-
-	// Print all arguments to 'out'
+	// Format the message into a local string, so parsers on different threads do not share any error state
 	va_list arg;
-	va_start(arg, msg);	
-	while(*msg != '\0') {
-		out << msg;
-		++msg;
-	}
+	va_start(arg, msg);
+
+	va_list arg_copy;
+	va_copy(arg_copy, arg);
+	int length = vsnprintf(nullptr, 0, msg, arg_copy);
+	va_end(arg_copy);
+
+	std::string out(std::max(length, 0), '\0');
+	vsnprintf(out.data(), out.size() + 1, msg, arg);
 	va_end(arg);
 
-	std::runtime_error ex(out.str());
+	std::runtime_error ex(out);
 	std::throw_with_nested(ex);
 }
 
@@ -0,0 +1,71 @@
+#ifndef PERFECT_HASH_HH
+#define PERFECT_HASH_HH
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Keyword tables that are hashed at compile time
+// Each key is given its own slot, so a lookup is one hash and at most one string comparison
+namespace PerfectHash {
+  struct Entry {
+    std::string_view key;
+    int value = -1;
+  };
+
+  // FNV-1a, with a seed mixed into the starting state
+  constexpr uint32_t hash(std::string_view key, uint32_t seed)
+  {
+    uint32_t value = 2166136261U ^ (seed * 2654435761U);
+    for(const char &ch : key) {
+      value ^= static_cast<unsigned char>(ch);
+      value *= 16777619U;
+    }
+
+    value ^= value >> 15;
+    return value;
+  }
+
+  // Table with 'Size' slots (at least four per key), where no two keys share a slot
+  template<size_t N, size_t Size = std::bit_ceil(N * 4)>
+  class Table {
+    public:
+      // Searches for a seed that places every key in a different slot
+      consteval explicit Table(const Entry (&entries)[N])
+      {
+        while(!try_seed(entries)) {
+          seed++;
+        }
+      }
+
+      // Returns the value for 'key', or -1 if it is not in the table
+      constexpr int lookup(std::string_view key) const
+      {
+        const Entry &slot = slots[hash(key, seed) & (Size - 1)];
+        return (!slot.key.empty() && slot.key == key) ? slot.value : -1;
+      }
+
+    private:
+      consteval bool try_seed(const Entry (&entries)[N])
+      {
+        slots = {};
+        for(const Entry &entry : entries) {
+          Entry &slot = slots[hash(entry.key, seed) & (Size - 1)];
+          if(!slot.key.empty()) {
+            return false;
+          }
+
+          slot = entry;
+        }
+
+        return true;
+      }
+
+      std::array<Entry, Size> slots{};
+      uint32_t seed = 0;
+  };
+} // namespace PerfectHash
+
+#endif // PERFECT_HASH_HH
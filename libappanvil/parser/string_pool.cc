@@ -0,0 +1,43 @@
+#include "string_pool.hh"
+
+#include <cstring>
+
+std::string_view StringPool::intern(std::string_view text)
+{
+  auto existing = strings.find(text);
+  if(existing != strings.end()) {
+    return *existing;
+  }
+
+  char *copy = allocate(text.size());
+  std::memcpy(copy, text.data(), text.size());
+
+  std::string_view interned(copy, text.size());
+  strings.insert(interned);
+  return interned;
+}
+
+size_t StringPool::size() const
+{
+  return strings.size();
+}
+
+char *StringPool::allocate(size_t length)
+{
+  // Strings that would take up most of a chunk get their own allocation, so the current chunk can keep being used
+  if(length > CHUNK_SIZE / 4) {
+    chunks.push_back(std::make_unique_for_overwrite<char[]>(length));
+    return chunks.back().get();
+  }
+
+  if(length > remaining) {
+    chunks.push_back(std::make_unique_for_overwrite<char[]>(CHUNK_SIZE));
+    current   = chunks.back().get();
+    remaining = CHUNK_SIZE;
+  }
+
+  char *storage = current;
+  current += length; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  remaining -= length;
+  return storage;
+}
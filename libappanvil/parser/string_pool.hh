@@ -0,0 +1,40 @@
+#ifndef STRING_POOL_HH
+#define STRING_POOL_HH
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Arena of interned strings, used for the text of tokens
+ *
+ * @details
+ * Strings are copied into large chunks instead of being allocated one at a time, and equal strings share a single copy.
+ * Views returned by intern() stay valid until the pool is destroyed.
+ */
+class StringPool {
+  public:
+    StringPool() = default;
+
+    // Returns a view of the pooled copy of 'text', copying it into the pool if it has not been seen yet
+    std::string_view intern(std::string_view text);
+
+    // Returns the number of distinct strings in the pool
+    size_t size() const;
+
+  private:
+    // Returns storage for 'length' characters
+    char *allocate(size_t length);
+
+    static constexpr size_t CHUNK_SIZE = 16384;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char *current = nullptr;
+    size_t remaining = 0;
+
+    std::unordered_set<std::string_view> strings;
+};
+
+#endif // STRING_POOL_HH
@@ -0,0 +1,154 @@
+#include "patch.hh"
+#include "content_hash.hh"
+
+#include <algorithm>
+#include <array>
+#include <ios>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+  // Puts back the format flags of a stream when it goes out of scope, including when an exception is thrown
+  class FlagsGuard {
+    public:
+      explicit FlagsGuard(std::ios_base &stream)
+        : stream{stream},
+          flags{stream.flags()}
+      {   }
+
+      FlagsGuard(const FlagsGuard &) = delete;
+      FlagsGuard &operator=(const FlagsGuard &) = delete;
+
+      ~FlagsGuard()
+      {
+        stream.flags(flags);
+      }
+
+    private:
+      std::ios_base &stream;
+      std::ios_base::fmtflags flags;
+  };
+} // namespace
+
+AppArmor::Patch::Patch(uint64_t base_hash, std::vector<Splice> splices)
+  : base_hash{base_hash},
+    splices{std::move(splices)}
+{   }
+
+uint64_t AppArmor::Patch::hash(std::string_view text)
+{
+  ContentHash result;
+  result.addBytes(text);
+  return result.value();
+}
+
+uint64_t AppArmor::Patch::hash(const PieceTable &text)
+{
+  // Adding the pieces one after another gives the same hash as adding the whole text at once
+  ContentHash result;
+  for(const auto &piece : text.pieces()) {
+    result.addBytes(piece);
+  }
+
+  return result.value();
+}
+
+uint64_t AppArmor::Patch::getBaseHash() const
+{
+  return base_hash;
+}
+
+const std::vector<AppArmor::Patch::Splice> &AppArmor::Patch::getSplices() const
+{
+  return splices;
+}
+
+void AppArmor::Patch::check(uint64_t text_hash, uint64_t text_size) const
+{
+  if(text_hash != base_hash) {
+    throw std::domain_error("Patch was made for different text than the text it is applied to");
+  }
+
+  uint64_t end = 0;
+  for(const auto &splice : splices) {
+    if(splice.pos < end || splice.pos > text_size || splice.length > text_size - splice.pos) {
+      throw std::out_of_range("Patch replaces text outside of the text it is applied to, or replaces the same text twice");
+    }
+
+    end = splice.pos + splice.length;
+  }
+}
+
+void AppArmor::Patch::apply(std::string &text) const
+{
+  check(hash(text), text.size());
+
+  // Apply the splices from last to first, so the positions of the earlier splices do not move
+  for(auto splice = splices.rbegin(); splice != splices.rend(); splice++) {
+    text.replace(splice->pos, splice->length, splice->text);
+  }
+}
+
+void AppArmor::Patch::apply(PieceTable &text) const
+{
+  check(hash(text), text.size());
+
+  for(auto splice = splices.rbegin(); splice != splices.rend(); splice++) {
+    text.replace(splice->pos, splice->length, splice->text);
+  }
+}
+
+AppArmor::Patch AppArmor::Patch::read(std::istream &input)
+{
+  const FlagsGuard guard(input);
+  std::string keyword;
+  uint64_t base_hash = 0;
+  size_t count = 0;
+  input >> keyword >> std::hex >> base_hash >> std::dec >> count;
+  if(!input || keyword != "patch") {
+    throw std::runtime_error("Expected a patch header");
+  }
+
+  std::vector<Splice> splices;
+  std::array<char, 65536> buffer{};
+  for(size_t i = 0; i < count; i++) {
+    Splice splice{};
+    uint64_t text_size = 0;
+    input >> splice.pos >> splice.length >> text_size;
+
+    // The text starts after the line break that ends the record
+    if(!input || input.get() != '\n') {
+      std::stringstream message;
+      message << "Expected the position, length and text size of splice " << i << " of the patch";
+      throw std::runtime_error(message.str());
+    }
+
+    // The text is read in blocks, so a size that is too large fails at the end of the input instead of allocating all of it first
+    uint64_t remaining = text_size;
+    while(remaining > 0) {
+      auto block = static_cast<std::streamsize>(std::min<uint64_t>(remaining, buffer.size()));
+      if(!input.read(buffer.data(), block)) {
+        throw std::runtime_error("Patch ended in the middle of the text of a splice");
+      }
+
+      splice.text.append(buffer.data(), static_cast<size_t>(block));
+      remaining -= static_cast<uint64_t>(block);
+    }
+
+    splices.push_back(std::move(splice));
+  }
+
+  return Patch(base_hash, std::move(splices));
+}
+
+std::ostream &AppArmor::operator<<(std::ostream &stream, const Patch &patch)
+{
+  const FlagsGuard guard(stream);
+  stream << "patch " << std::hex << patch.getBaseHash() << std::dec << ' ' << patch.getSplices().size() << '\n';
+  for(const auto &splice : patch.getSplices()) {
+    stream << splice.pos << ' ' << splice.length << ' ' << splice.text.size() << '\n' << splice.text;
+  }
+
+  return stream;
+}
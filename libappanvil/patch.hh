@@ -0,0 +1,76 @@
+#ifndef PATCH_HH
+#define PATCH_HH
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "piece_table.hh"
+
+namespace AppArmor {
+  /**
+  * @brief A change to the text of a file, as a list of replacements and the hash of the text they apply to
+  *
+  * @details
+  * A Parser in OutputMode::Patch writes one of these for each change, instead of the whole file,
+  * so the size of the output depends on the size of the change rather than the size of the file.
+  *
+  * The written form is a line "patch <hash of the base text, in hex> <number of splices>", followed by one record per splice:
+  * a line "<pos> <length> <size of text>" and then exactly that many bytes of replacement text.
+  */
+  class Patch {
+    public:
+      // Replaces 'length' characters at 'pos' of the base text with 'text'
+      struct Splice {
+        uint64_t pos;
+        uint64_t length;
+        std::string text;
+
+        bool operator==(const Splice &other) const = default;
+      };
+
+      Patch() = default;
+
+      // The splices must be sorted by position, and must not replace the same characters twice
+      Patch(uint64_t base_hash, std::vector<Splice> splices);
+
+      // Returns the hash of a file's text, which a patch is checked against before it is applied
+      static uint64_t hash(std::string_view text);
+      static uint64_t hash(const PieceTable &text);
+
+      uint64_t getBaseHash() const;
+      const std::vector<Splice> &getSplices() const;
+
+      /**
+      * @brief Applies this patch to 'text', replacing its contents
+      *
+      * @throws std::domain_error if 'text' is not the text that this patch was made for
+      * @throws std::out_of_range if a splice is outside of 'text'
+      */
+      void apply(std::string &text) const;
+      void apply(PieceTable &text) const;
+
+      /**
+      * @brief Reads a patch in the form written by operator<<
+      *
+      * @throws std::runtime_error if the input is not a valid patch
+      */
+      static Patch read(std::istream &input);
+
+      bool operator==(const Patch &other) const = default;
+
+    private:
+      // Checks the hash and bounds of this patch against text of the given hash and size
+      void check(uint64_t text_hash, uint64_t text_size) const;
+
+      uint64_t base_hash = 0;
+      std::vector<Splice> splices;
+  };
+
+  std::ostream &operator<<(std::ostream &stream, const Patch &patch);
+} // namespace AppArmor
+
+#endif // PATCH_HH
@@ -0,0 +1,287 @@
+#include "piece_table.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+AppArmor::PieceTable::PieceTable()
+  : PieceTable(std::string())
+{   }
+
+AppArmor::PieceTable::PieceTable(std::string original)
+  : original_text{std::make_shared<const std::string>(std::move(original))}
+{
+  revert();
+}
+
+AppArmor::PieceTable::PieceTable(const PieceTable &other)
+  : original_text{other.original_text},
+    added_blocks{other.added_blocks},
+    last_block_size{other.last_block_size},
+    added_capacity{other.added_capacity},
+    added_used{other.added_used},
+    piece_list{other.piece_list},
+    document_size{other.document_size}
+{   }
+
+AppArmor::PieceTable &AppArmor::PieceTable::operator=(const PieceTable &other)
+{
+  if(this != &other) {
+    original_text   = other.original_text;
+    added_blocks    = other.added_blocks;
+    last_block_size = other.last_block_size;
+    owns_last_block = false;
+    added_capacity  = other.added_capacity;
+    added_used      = other.added_used;
+    piece_list      = other.piece_list;
+    document_size   = other.document_size;
+  }
+
+  return *this;
+}
+
+void AppArmor::PieceTable::replace(uint64_t pos, uint64_t length, std::string_view text)
+{
+  if(pos > document_size || length > document_size - pos) {
+    throw std::out_of_range("replaced text is outside of the document");
+  }
+
+  // Remove the pieces that cover the replaced text
+  // Splitting at the end cannot move the pieces before it, so 'first' stays valid
+  auto first = split(pos);
+  auto last  = split(pos + length);
+  for(auto i = first; i < last; i++) {
+    if(piece_list[i].block != ORIGINAL) {
+      added_used -= piece_list[i].length;
+    }
+  }
+  piece_list.erase(piece_list.begin() + static_cast<int64_t>(first), piece_list.begin() + static_cast<int64_t>(last));
+
+  if(!text.empty()) {
+    Piece added = appendText(text);
+    added_used += added.length;
+
+    // Text typed one change after another can grow the previous piece instead of adding a new one
+    Piece *previous = (first > 0) ? &piece_list[first - 1] : nullptr;
+    if(previous != nullptr && previous->block == added.block && previous->start + previous->length == added.start) {
+      previous->length += added.length;
+    } else {
+      piece_list.insert(piece_list.begin() + static_cast<int64_t>(first), added);
+    }
+  }
+
+  document_size = document_size - length + text.size();
+
+  // Copying the used text only once the unused text is larger keeps the cost of a change constant on average
+  if(added_capacity > 2 * (added_used + BLOCK_SIZE)) {
+    compact();
+  }
+}
+
+void AppArmor::PieceTable::revert()
+{
+  added_blocks.clear();
+  last_block_size = 0;
+  owns_last_block = false;
+  added_capacity = 0;
+  added_used = 0;
+  document_size = original_text->size();
+
+  piece_list.clear();
+  if(document_size > 0) {
+    piece_list.push_back(Piece{ORIGINAL, 0, document_size});
+  }
+}
+
+uint64_t AppArmor::PieceTable::addedCapacity() const
+{
+  return added_capacity;
+}
+
+uint64_t AppArmor::PieceTable::size() const
+{
+  return document_size;
+}
+
+std::string_view AppArmor::PieceTable::original() const
+{
+  return *original_text;
+}
+
+bool AppArmor::PieceTable::isOriginal() const
+{
+  if(document_size != original_text->size()) {
+    return false;
+  }
+
+  // Compare each piece with the same range of the original text
+  std::string_view remaining = *original_text;
+  for(const auto &piece : piece_list) {
+    auto piece_text = text(piece);
+    if(piece.block == ORIGINAL && piece.start == original_text->size() - remaining.size()) {
+      // The piece points at the same place in the original text
+      remaining.remove_prefix(piece.length);
+      continue;
+    }
+
+    if(remaining.substr(0, piece_text.size()) != piece_text) {
+      return false;
+    }
+    remaining.remove_prefix(piece_text.size());
+  }
+
+  return true;
+}
+
+std::vector<std::string_view> AppArmor::PieceTable::pieces() const
+{
+  std::vector<std::string_view> result;
+  result.reserve(piece_list.size());
+
+  for(const auto &piece : piece_list) {
+    result.push_back(text(piece));
+  }
+
+  return result;
+}
+
+std::vector<std::string_view> AppArmor::PieceTable::pieces(uint64_t pos, uint64_t length) const
+{
+  if(pos > document_size || length > document_size - pos) {
+    throw std::out_of_range("requested text is outside of the document");
+  }
+
+  std::vector<std::string_view> result;
+  uint64_t piece_pos = 0;
+
+  for(const auto &piece : piece_list) {
+    if(length == 0) {
+      break;
+    }
+
+    // Skip pieces that end before the requested range
+    if(piece_pos + piece.length <= pos) {
+      piece_pos += piece.length;
+      continue;
+    }
+
+    auto piece_text = text(piece).substr(pos - piece_pos, length);
+    result.push_back(piece_text);
+
+    pos       += piece_text.size();
+    length    -= piece_text.size();
+    piece_pos += piece.length;
+  }
+
+  return result;
+}
+
+AppArmor::PieceTable::operator std::string() const
+{
+  std::string result;
+  result.reserve(document_size);
+
+  for(const auto &piece : piece_list) {
+    result.append(text(piece));
+  }
+
+  return result;
+}
+
+std::ostream &AppArmor::operator<<(std::ostream &stream, const PieceTable &table)
+{
+  for(const auto &piece : table.piece_list) {
+    stream << table.text(piece);
+  }
+
+  return stream;
+}
+
+std::string_view AppArmor::PieceTable::text(const Piece &piece) const
+{
+  if(piece.block == ORIGINAL) {
+    return std::string_view(*original_text).substr(piece.start, piece.length);
+  }
+
+  return std::string_view(added_blocks[piece.block].data.get() + piece.start, piece.length); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+AppArmor::PieceTable::Piece AppArmor::PieceTable::appendText(std::string_view text)
+{
+  // Copies of this table may point into the last block, so only its owner writes past their text
+  if(!owns_last_block || added_blocks.empty() || added_blocks.back().capacity - last_block_size < text.size()) {
+    auto capacity = std::max<uint64_t>(BLOCK_SIZE, text.size());
+    added_blocks.push_back(Block{std::make_shared<char[]>(capacity), capacity});
+    last_block_size = 0;
+    owns_last_block = true;
+    added_capacity += capacity;
+  }
+
+  Piece added{static_cast<uint32_t>(added_blocks.size() - 1), last_block_size, text.size()};
+  std::memcpy(added_blocks.back().data.get() + last_block_size, text.data(), text.size()); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  last_block_size += text.size();
+
+  return added;
+}
+
+void AppArmor::PieceTable::compact()
+{
+  auto capacity = std::max(BLOCK_SIZE, added_used);
+  Block block{std::make_shared<char[]>(capacity), capacity};
+  uint64_t size = 0;
+
+  std::vector<Piece> compacted;
+  compacted.reserve(piece_list.size());
+  for(const auto &piece : piece_list) {
+    if(piece.block == ORIGINAL) {
+      compacted.push_back(piece);
+      continue;
+    }
+
+    std::memcpy(block.data.get() + size, text(piece).data(), piece.length); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    // Inserted pieces that are next to each other become one piece
+    if(!compacted.empty() && compacted.back().block != ORIGINAL) {
+      compacted.back().length += piece.length;
+    } else {
+      compacted.push_back(Piece{0, size, piece.length});
+    }
+    size += piece.length;
+  }
+
+  // Copies of this table keep the old blocks for as long as they need them
+  added_blocks.clear();
+  added_blocks.push_back(std::move(block));
+  piece_list = std::move(compacted);
+
+  last_block_size = size;
+  owns_last_block = true;
+  added_capacity  = capacity;
+}
+
+size_t AppArmor::PieceTable::split(uint64_t pos)
+{
+  uint64_t piece_pos = 0;
+
+  for(size_t i = 0; i < piece_list.size(); i++) {
+    Piece &piece = piece_list[i];
+    if(piece_pos == pos) {
+      return i;
+    }
+
+    if(pos < piece_pos + piece.length) {
+      // Cut the piece in two at 'pos'
+      auto offset = pos - piece_pos;
+      Piece second{piece.block, piece.start + offset, piece.length - offset};
+      piece.length = offset;
+
+      piece_list.insert(piece_list.begin() + static_cast<int64_t>(i) + 1, second);
+      return i + 1;
+    }
+
+    piece_pos += piece.length;
+  }
+
+  return piece_list.size();
+}
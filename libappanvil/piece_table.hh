@@ -0,0 +1,123 @@
+#ifndef PIECE_TABLE_HH
+#define PIECE_TABLE_HH
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AppArmor {
+  /**
+  * @brief Stores the text of a file as a list of pieces, so that it can be changed without copying the whole file
+  *
+  * @details
+  * The original text is never modified. Inserted text is appended to separate buffers,
+  * and the document is the sequence of pieces that point into these buffers.
+  * A change only touches the pieces around it, so its cost depends on the number of changes rather than the size of the file.
+  *
+  * Inserted text is stored in blocks of at least BLOCK_SIZE characters, which never move once they are allocated.
+  * Copying a PieceTable is cheap, since the original text and the blocks are shared between the copies.
+  * Only the table that allocated a block appends to it, and only past the text that was in it when it was copied.
+  * So a copy never sees its text change, and copies can be changed on different threads.
+  *
+  * Replaced text stays in its block. Once most of the blocks hold text that is no longer in the document,
+  * the text that is still used is copied into a single block, so the blocks use at most about twice as much memory as that text.
+  */
+  class PieceTable {
+    public:
+      PieceTable();
+      explicit PieceTable(std::string original);
+
+      // A copy shares the blocks of 'other', but appends the text inserted into it to blocks of its own
+      PieceTable(const PieceTable &other);
+      PieceTable(PieceTable &&other) = default;
+      PieceTable &operator=(const PieceTable &other);
+      PieceTable &operator=(PieceTable &&other) = default;
+      ~PieceTable() = default;
+
+      // Replaces 'length' characters at 'pos' with 'text'
+      void replace(uint64_t pos, uint64_t length, std::string_view text);
+
+      // Drops every change, so the document is the original text again
+      void revert();
+
+      // Returns the number of characters in the document
+      uint64_t size() const;
+
+      // Returns the text that this table was created with
+      std::string_view original() const;
+
+      // Returns true if the document has the same text as the original
+      bool isOriginal() const;
+
+      // Returns the number of characters allocated for inserted text, including text that was replaced since
+      uint64_t addedCapacity() const;
+
+      // Returns the text of the document, in order
+      // The views are invalidated by the next call to replace()
+      std::vector<std::string_view> pieces() const;
+
+      // Returns the text of 'length' characters starting at 'pos', in order
+      std::vector<std::string_view> pieces(uint64_t pos, uint64_t length) const;
+
+      // Copies the text of the document into a single string
+      explicit operator std::string() const;
+
+      friend std::ostream &operator<<(std::ostream &stream, const PieceTable &table);
+
+    private:
+      // The 'block' of a piece that points into the original text
+      static constexpr uint32_t ORIGINAL = UINT32_MAX;
+
+      // The smallest block allocated for inserted text
+      static constexpr uint64_t BLOCK_SIZE = 4096;
+
+      struct Piece {
+        uint32_t block; // ORIGINAL, or an index into 'added_blocks'
+        uint64_t start;
+        uint64_t length;
+      };
+
+      struct Block {
+        std::shared_ptr<char[]> data;
+        uint64_t capacity;
+      };
+
+      // Returns the text that a piece points to
+      std::string_view text(const Piece &piece) const;
+
+      // Splits the piece containing 'pos' (if needed) so that a piece starts at 'pos'
+      // Returns the index of that piece, or the number of pieces if 'pos' is the end of the document
+      size_t split(uint64_t pos);
+
+      // Stores inserted text in the last block if this table owns it and it has room, or in a new block otherwise
+      // Returns the piece that points to the stored text
+      Piece appendText(std::string_view text);
+
+      // Copies the inserted text that is still in the document into a single block, and drops the other blocks
+      void compact();
+
+      std::shared_ptr<const std::string> original_text;
+
+      // Blocks that may be shared with copies of this table
+      std::vector<Block> added_blocks;
+
+      // The number of characters of the last block used by this table, and whether this table may append to it
+      uint64_t last_block_size = 0;
+      bool owns_last_block = false;
+
+      // The number of characters in 'added_blocks', and how many of them are in the document
+      uint64_t added_capacity = 0;
+      uint64_t added_used = 0;
+
+      std::vector<Piece> piece_list;
+      uint64_t document_size = 0;
+  };
+
+  // Writes every piece of the document to 'stream', without copying them into one string
+  std::ostream &operator<<(std::ostream &stream, const PieceTable &table);
+} // namespace AppArmor
+
+#endif // PIECE_TABLE_HH
@@ -0,0 +1,306 @@
+#include "profile_diff.hh"
+#include "apparmor_parser.hh"
+#include "content_hash.hh"
+
+#include <array>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+  using AppArmor::ChangeKind;
+  using AppArmor::Profile;
+  using AppArmor::ProfileChange;
+  using AppArmor::ProfileHasher;
+  using AppArmor::RuleChange;
+  using AppArmor::RuleNode;
+  using AppArmor::Tree::RuleKind;
+
+  constexpr size_t rule_kind_count = static_cast<size_t>(RuleKind::Generic) + 1;
+
+  // A rule of a profile and the hash of its content
+  struct HashedRule {
+    const RuleNode *rule;
+    uint64_t hash;
+  };
+
+  // Returns the rules of a profile in the order they appear, leaving out its subprofiles and hats
+  std::vector<HashedRule> hash_rules(const Profile &profile, const ProfileHasher &hasher)
+  {
+    std::vector<HashedRule> result;
+    profile.visit([&](const auto &rule) {
+      if constexpr(std::is_base_of_v<RuleNode, std::remove_cvref_t<decltype(rule)>>) {
+        result.push_back(HashedRule{&rule, hasher.hash(rule)});
+      }
+    });
+
+    return result;
+  }
+
+  // Returns the subprofiles and hats of a profile in the order they appear
+  std::vector<const Profile *> nested_profiles(const Profile &profile)
+  {
+    std::vector<const Profile *> result;
+    profile.visit([&](const auto &rule) {
+      if constexpr(std::is_same_v<Profile, std::remove_cvref_t<decltype(rule)>>) {
+        result.push_back(&rule);
+      }
+    });
+
+    return result;
+  }
+
+  /**
+  * Finds a longest common subsequence of the hashes of 'before' and 'after', and marks the rules in it as kept
+  *
+  * Uses Myers' algorithm, which takes O((N + M) * D) time and O(D * D) memory for D added and removed rules.
+  * The rules at either end that did not change are skipped first, so a single edit to a long profile is cheap.
+  */
+  void mark_common(const std::vector<HashedRule> &before, const std::vector<HashedRule> &after,
+                   std::vector<bool> &before_kept, std::vector<bool> &after_kept)
+  {
+    before_kept.assign(before.size(), false);
+    after_kept.assign(after.size(), false);
+
+    size_t prefix = 0;
+    while(prefix < before.size() && prefix < after.size() && before[prefix].hash == after[prefix].hash) {
+      before_kept[prefix] = true;
+      after_kept[prefix]  = true;
+      prefix++;
+    }
+
+    size_t suffix = 0;
+    while(suffix < before.size() - prefix && suffix < after.size() - prefix &&
+          before[before.size() - suffix - 1].hash == after[after.size() - suffix - 1].hash) {
+      before_kept[before.size() - suffix - 1] = true;
+      after_kept[after.size() - suffix - 1]   = true;
+      suffix++;
+    }
+
+    // Positions below are relative to the first rule after the common prefix
+    const auto before_size = static_cast<int64_t>(before.size() - prefix - suffix);
+    const auto after_size  = static_cast<int64_t>(after.size() - prefix - suffix);
+    auto equal = [&](int64_t x, int64_t y) {
+      return before[prefix + static_cast<size_t>(x)].hash == after[prefix + static_cast<size_t>(y)].hash;
+    };
+
+    // 'furthest' holds the furthest position in 'before' reached on each diagonal (x - y) so far
+    // Diagonals are offset so that the neighbours of every reachable diagonal have an index
+    const int64_t offset = before_size + after_size + 1;
+    std::vector<int64_t> furthest(static_cast<size_t>(2 * offset + 1), 0);
+
+    // The diagonals -d to d of 'furthest' before each step d, to walk the path back once the end is reached
+    std::vector<std::vector<int64_t>> history;
+
+    // Whether the path to diagonal k in step d comes from diagonal k + 1 (adding a rule), rather than k - 1 (removing one)
+    auto from_added = [](auto &&reached, int64_t k, int64_t d) {
+      return k == -d || (k != d && reached(k - 1) < reached(k + 1));
+    };
+
+    int64_t steps = -1;
+    for(int64_t d = 0; steps < 0; d++) {
+      history.emplace_back(furthest.begin() + (offset - d), furthest.begin() + (offset + d + 1));
+      auto reached = [&](int64_t k) { return furthest[static_cast<size_t>(offset + k)]; };
+
+      for(int64_t k = -d; k <= d; k += 2) {
+        int64_t x = from_added(reached, k, d) ? reached(k + 1) : reached(k - 1) + 1;
+        int64_t y = x - k;
+
+        // Follow the rules that are the same in both lists
+        while(x < before_size && y < after_size && equal(x, y)) {
+          x++;
+          y++;
+        }
+
+        furthest[static_cast<size_t>(offset + k)] = x;
+        if(x >= before_size && y >= after_size) {
+          steps = d;
+          break;
+        }
+      }
+    }
+
+    auto keep = [&](int64_t x, int64_t y) {
+      before_kept[prefix + static_cast<size_t>(x)] = true;
+      after_kept[prefix + static_cast<size_t>(y)]  = true;
+    };
+
+    int64_t x = before_size;
+    int64_t y = after_size;
+    for(int64_t d = steps; d > 0; d--) {
+      const auto &previous = history[static_cast<size_t>(d)];
+      auto reached = [&](int64_t k) { return previous[static_cast<size_t>(k + d)]; };
+
+      const int64_t k = x - y;
+      const int64_t previous_k = from_added(reached, k, d) ? k + 1 : k - 1;
+      const int64_t previous_x = reached(previous_k);
+      const int64_t previous_y = previous_x - previous_k;
+
+      // The rules after the added or removed rule are the same in both lists
+      while(x > previous_x && y > previous_y) {
+        x--;
+        y--;
+        keep(x, y);
+      }
+
+      x = previous_x;
+      y = previous_y;
+    }
+
+    while(x > 0 && y > 0) {
+      x--;
+      y--;
+      keep(x, y);
+    }
+  }
+
+  // Converts the rules that are not kept into changes
+  // Between two kept rules, a removed and an added rule of the same kind are reported as one modified rule
+  std::vector<RuleChange> rule_changes(const std::vector<HashedRule> &before, const std::vector<HashedRule> &after,
+                                       const std::vector<bool> &before_kept, const std::vector<bool> &after_kept)
+  {
+    std::vector<RuleChange> changes;
+    std::array<std::vector<size_t>, rule_kind_count> added_by_kind;
+    std::vector<bool> paired;
+
+    size_t i = 0;
+    size_t j = 0;
+    while(i < before.size() || j < after.size()) {
+      size_t removed_end = i;
+      while(removed_end < before.size() && !before_kept[removed_end]) {
+        removed_end++;
+      }
+
+      size_t added_end = j;
+      while(added_end < after.size() && !after_kept[added_end]) {
+        added_end++;
+      }
+
+      // Pair the removed and added rules of each kind in order, so that the first removed rule is paired with the first added rule
+      const size_t added_begin = j;
+      for(auto &added : added_by_kind) {
+        added.clear();
+      }
+
+      for(size_t added = added_end; added > added_begin; added--) {
+        added_by_kind.at(static_cast<size_t>(after[added - 1].rule->getRuleKind())).push_back(added - 1);
+      }
+
+      paired.assign(added_end - added_begin, false);
+      for(; i < removed_end; i++) {
+        const RuleNode *rule = before[i].rule;
+        auto &added = added_by_kind.at(static_cast<size_t>(rule->getRuleKind()));
+        if(added.empty()) {
+          changes.push_back(RuleChange{ChangeKind::Removed, rule->getRuleKind(), rule, nullptr});
+          continue;
+        }
+
+        paired[added.back() - added_begin] = true;
+        changes.push_back(RuleChange{ChangeKind::Modified, rule->getRuleKind(), rule, after[added.back()].rule});
+        added.pop_back();
+      }
+
+      for(; j < added_end; j++) {
+        if(!paired[j - added_begin]) {
+          const RuleNode *rule = after[j].rule;
+          changes.push_back(RuleChange{ChangeKind::Added, rule->getRuleKind(), nullptr, rule});
+        }
+      }
+
+      // Skip the rule that is in both lists
+      if(i < before.size() && j < after.size()) {
+        i++;
+        j++;
+      }
+    }
+
+    return changes;
+  }
+
+  // Matches profiles with the same name in the order they appear, and reports the others as added or removed
+  template<class Matched>
+  void match_profiles(const std::vector<const Profile *> &before, const std::vector<const Profile *> &after,
+                      const std::string &prefix, std::vector<ProfileChange> &changes, Matched &&matched)
+  {
+    // The indexes of the profiles with each name, with the first one last
+    std::unordered_map<std::string_view, std::vector<size_t>> after_by_name;
+    for(size_t index = after.size(); index > 0; index--) {
+      after_by_name[after[index - 1]->name()].push_back(index - 1);
+    }
+
+    std::vector<bool> after_matched(after.size(), false);
+    for(const Profile *profile : before) {
+      auto found = after_by_name.find(profile->name());
+      if(found == after_by_name.end() || found->second.empty()) {
+        changes.push_back(ProfileChange{ChangeKind::Removed, prefix + profile->name(), profile, nullptr, {}});
+        continue;
+      }
+
+      const size_t index = found->second.back();
+      found->second.pop_back();
+      after_matched[index] = true;
+      matched(*profile, *after[index], prefix + profile->name());
+    }
+
+    for(size_t index = 0; index < after.size(); index++) {
+      if(!after_matched[index]) {
+        changes.push_back(ProfileChange{ChangeKind::Added, prefix + after[index]->name(), nullptr, after[index], {}});
+      }
+    }
+  }
+
+  // Compares two profiles with the same name, then their subprofiles and hats
+  void diff_profile(const Profile &before, const ProfileHasher &before_hasher,
+                    const Profile &after, const ProfileHasher &after_hasher,
+                    const std::string &name, std::vector<ProfileChange> &changes)
+  {
+    auto before_rules = hash_rules(before, before_hasher);
+    auto after_rules  = hash_rules(after, after_hasher);
+
+    std::vector<bool> before_kept;
+    std::vector<bool> after_kept;
+    mark_common(before_rules, after_rules, before_kept, after_kept);
+
+    auto rules = rule_changes(before_rules, after_rules, before_kept, after_kept);
+    bool header_changed = before_hasher.header(before).value() != after_hasher.header(after).value();
+    if(header_changed || !rules.empty()) {
+      changes.push_back(ProfileChange{ChangeKind::Modified, name, &before, &after, std::move(rules)});
+    }
+
+    match_profiles(nested_profiles(before), nested_profiles(after), name + "//", changes,
+      [&](const Profile &before_nested, const Profile &after_nested, const std::string &nested_name) {
+        diff_profile(before_nested, before_hasher, after_nested, after_hasher, nested_name, changes);
+      });
+  }
+} // namespace
+
+std::vector<AppArmor::ProfileChange> AppArmor::Parser::diff(const Parser &other) const
+{
+  std::vector<const Profile *> before;
+  for(const auto &profile : profile_list) {
+    before.push_back(&profile);
+  }
+
+  std::vector<const Profile *> after;
+  for(const auto &profile : other.profile_list) {
+    after.push_back(&profile);
+  }
+
+  std::vector<ProfileChange> changes;
+  match_profiles(before, after, "", changes,
+    [&](const Profile &before_profile, const Profile &after_profile, const std::string &name) {
+      // Both hashes ignore positions and whitespace, so equal hashes mean that nothing changed
+      if(before_profile.getHash() != 0 && before_profile.getHash() == after_profile.getHash()) {
+        return;
+      }
+
+      std::string before_storage;
+      std::string after_storage;
+      ProfileHasher before_hasher(profile_text(before_profile, before_storage), before_profile.getStartPosition());
+      ProfileHasher after_hasher(other.profile_text(after_profile, after_storage), after_profile.getStartPosition());
+      diff_profile(before_profile, before_hasher, after_profile, after_hasher, name, changes);
+    });
+
+  return changes;
+}
@@ -0,0 +1,51 @@
+#ifndef PROFILE_DIFF_HH
+#define PROFILE_DIFF_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tree/ProfileRule.hh"
+#include "tree/RuleNode.hh"
+
+namespace AppArmor {
+  // How a profile or rule differs between two parse states (see Parser::diff())
+  enum class ChangeKind : uint8_t {
+    Added,
+    Removed,
+    Modified
+  };
+
+  struct RuleChange {
+    ChangeKind change;
+
+    // The kind of rule, which tells which class 'before' and 'after' point to (such as Tree::FileRule for RuleKind::File)
+    Tree::RuleKind kind;
+
+    // The rule in the older parser, or nullptr if it was added
+    const Tree::RuleNode *before;
+
+    // The rule in the newer parser, or nullptr if it was removed
+    const Tree::RuleNode *after;
+  };
+
+  struct ProfileChange {
+    ChangeKind change;
+
+    // The name of the profile, with the names of subprofiles and hats following their parent's, as in "parent//child"
+    std::string name;
+
+    // The profile in the older parser, or nullptr if it was added
+    const Tree::ProfileRule *before;
+
+    // The profile in the newer parser, or nullptr if it was removed
+    const Tree::ProfileRule *after;
+
+    // The rules that changed in a modified profile, in the order they appear in the file
+    // Empty if only the name, attachment or flags of the profile changed, or if the profile was added or removed
+    // Changes to subprofiles and hats are listed as separate profiles
+    std::vector<RuleChange> rules;
+  };
+} // namespace AppArmor
+
+#endif // PROFILE_DIFF_HH
@@ -0,0 +1,71 @@
+#include "source_map.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+AppArmor::SourceMap::SourceMap()
+  : line_starts{0}
+{   }
+
+void AppArmor::SourceMap::addLineBreaks(const char *text, uint64_t length, uint64_t offset)
+{
+  const char *end = text + length; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  const char *pos = text;
+
+  while(pos < end) {
+    pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+    if(pos == nullptr) {
+      break;
+    }
+
+    pos++; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    line_starts.push_back(offset + (pos - text));
+  }
+}
+
+void AppArmor::SourceMap::replaceText(uint64_t pos, uint64_t erased, std::string_view inserted)
+{
+  // Line starts in (pos, pos + erased] came from line breaks in the erased text
+  auto first = std::upper_bound(line_starts.begin(), line_starts.end(), pos);
+  auto last  = std::upper_bound(first, line_starts.end(), pos + erased);
+
+  // Move the line starts after the erased text
+  uint64_t delta = inserted.size() - erased;
+  for(auto it = last; it != line_starts.end(); it++) {
+    *it += delta;
+  }
+
+  // Swap the erased line starts for those of the inserted text
+  SourceMap added;
+  added.addLineBreaks(inserted.data(), inserted.size(), pos);
+
+  auto index = first - line_starts.begin();
+  line_starts.erase(first, last);
+  line_starts.insert(line_starts.begin() + index, added.line_starts.begin() + 1, added.line_starts.end());
+}
+
+AppArmor::SourceMap::Location AppArmor::SourceMap::getLocation(uint64_t pos) const
+{
+  // Find the last line that starts at or before 'pos'
+  auto line = std::upper_bound(line_starts.begin(), line_starts.end(), pos) - 1;
+
+  Location location{};
+  location.line   = (line - line_starts.begin()) + 1;
+  location.column = (pos - *line) + 1;
+  return location;
+}
+
+uint64_t AppArmor::SourceMap::getLineCount() const
+{
+  return line_starts.size();
+}
+
+uint64_t AppArmor::SourceMap::getLineStart(uint64_t line) const
+{
+  if(line == 0 || line > line_starts.size()) {
+    throw std::out_of_range("line number is out of range");
+  }
+
+  return line_starts[line - 1];
+}
@@ -0,0 +1,50 @@
+#ifndef SOURCE_MAP_HH
+#define SOURCE_MAP_HH
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace AppArmor {
+  /**
+  * @brief Maps character positions of a parsed file to line and column numbers
+  *
+  * @details
+  * The lexer records the offset of every line break it consumes, so no extra pass over the file is needed.
+  * Looking up a position is a binary search over the recorded line starts.
+  */
+  class SourceMap {
+    public:
+      // Line and column numbers both start at 1
+      struct Location {
+        uint64_t line;
+        uint64_t column;
+
+        bool operator==(const Location &other) const = default;
+      };
+
+      SourceMap();
+
+      // Records the line breaks in 'text', which starts at character position 'offset' of the file
+      void addLineBreaks(const char *text, uint64_t length, uint64_t offset);
+
+      // Updates the map after 'erased' characters at 'pos' were replaced with 'inserted'
+      // Only the line starts at or after 'pos' are touched, so the rest of the file is not scanned again
+      void replaceText(uint64_t pos, uint64_t erased, std::string_view inserted);
+
+      // Returns the line and column of a character position (such as RuleNode::getStartPosition())
+      Location getLocation(uint64_t pos) const;
+
+      // Returns the number of lines seen by the lexer
+      uint64_t getLineCount() const;
+
+      // Returns the character position where a line (starting at 1) begins
+      uint64_t getLineStart(uint64_t line) const;
+
+    private:
+      // Character position of the first character of each line, in increasing order
+      std::vector<uint64_t> line_starts;
+  };
+} // namespace AppArmor
+
+#endif // SOURCE_MAP_HH
@@ -3,7 +3,7 @@
 #include <sstream>
 
 AppArmor::Tree::AbstractionRule::AbstractionRule(uint64_t startPos, uint64_t stopPos, const std::string &path, bool is_relative, bool is_if_exists)
-  : RuleNode("abstraction", startPos, stopPos),
+  : RuleNode(RuleKind::Abstraction, startPos, stopPos),
     path{path},
     is_relative{is_relative},
     is_if_exists{is_if_exists}
@@ -13,7 +13,7 @@ AppArmor::Tree::AbstractionRule::AbstractionRule(const std::string &path, bool i
   : AbstractionRule(0, -1, path, is_relative, is_if_exists)
 {   }
 
-std::string AppArmor::Tree::AbstractionRule::getPath() const
+const std::string &AppArmor::Tree::AbstractionRule::getPath() const
 {
   return path;
 }
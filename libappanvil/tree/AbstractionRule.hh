@@ -19,7 +19,7 @@ namespace AppArmor::Tree {
                                bool is_relative = true,
                                bool is_if_exists = false);
 
-      std::string getPath() const;
+      const std::string &getPath() const;
       bool isRelative() const;
       bool isIfExists() const;
 
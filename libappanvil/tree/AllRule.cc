@@ -5,7 +5,7 @@
 #include <stdexcept>
 
 AppArmor::Tree::AllRule::AllRule(const PrefixNode &prefix, uint64_t startPos, uint64_t stopPos)
-  : RuleNode(startPos, stopPos)
+  : RuleNode(RuleKind::All, startPos, stopPos)
 {
   if(prefix.getOwner())
   {
@@ -1,156 +1,108 @@
 #include "FileMode.hh"
 #include "parser/parser.h"
 
-#include <cctype>
-#include <iterator>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
-AppArmor::Tree::FileMode::FileMode(bool read, bool write, bool append, bool memory_map, bool link, bool lock, const std::string &execute_mode)
-  : AppArmor::Tree::FileMode::FileMode(buildString(read, write, append, memory_map, link, lock, execute_mode))
-{ }
+// The lookup table in FileMode.hh spells out the characters of parser.h
+static_assert(COD_READ_CHAR == 'r' && COD_WRITE_CHAR == 'w' && COD_APPEND_CHAR == 'a' && COD_MMAP_CHAR == 'm' &&
+              COD_LINK_CHAR == 'l' && COD_LOCK_CHAR == 'k' && COD_EXEC_CHAR == 'x' && COD_INHERIT_CHAR == 'i' &&
+              COD_UNCONFINED_CHAR == 'U' && COD_UNSAFE_UNCONFINED_CHAR == 'u' &&
+              COD_PROFILE_CHAR == 'P' && COD_UNSAFE_PROFILE_CHAR == 'p' &&
+              COD_LOCAL_CHAR == 'C' && COD_UNSAFE_LOCAL_CHAR == 'c',
+              "FileMode::char_codes is out of date");
 
-AppArmor::Tree::FileMode::FileMode(const std::string &mode)
+void AppArmor::Tree::FileMode::throwUnexpectedCharacter(char ch)
 {
-  std::stringstream potential_execute_mode;
-  for(const char &ch : mode) {
-    auto lower_ch = std::tolower(ch);
-    switch(lower_ch) {
-      case COD_READ_CHAR:
-        read = true;
-        break;
-
-      case COD_WRITE_CHAR:
-        if(append) {
-          throw std::runtime_error("Both write and append permissions granted to same file_rule, which is not allowed.");
-        }
-
-        write = true;
-        break;
-
-      case COD_APPEND_CHAR:
-        if(write) {
-          throw std::runtime_error("Both write and append permissions granted to same file_rule, which is not allowed.");
-        }
-
-        append = true;
-        break;
-
-      case COD_LINK_CHAR:
-        link = true;
-        break;
-
-      case COD_LOCK_CHAR:
-        lock = true;
-        break;
-
-      case COD_MMAP_CHAR:
-        memory_map = true;
-        break;
-
-      case COD_INHERIT_CHAR:
-      case COD_UNSAFE_UNCONFINED_CHAR:
-      case COD_UNCONFINED_CHAR:
-      case COD_UNSAFE_PROFILE_CHAR:
-      case COD_PROFILE_CHAR:
-      case COD_UNSAFE_LOCAL_CHAR:
-      case COD_LOCAL_CHAR:
-        potential_execute_mode << ch;
-        continue;
-
-      case COD_EXEC_CHAR:
-        potential_execute_mode << ch;
-        execute_mode = potential_execute_mode.str();
-        break;
-
-      default:
-        std::stringstream message;
-        message << "Encountered unexpected character when parsing file mode: " << ch;
-        throw std::runtime_error(message.str());
-    }
-  }
-}
-
-bool AppArmor::Tree::FileMode::getRead() const
-{
-  return read;
+  std::stringstream message;
+  message << "Encountered unexpected character when parsing file mode: " << ch;
+  throw std::runtime_error(message.str());
 }
 
-bool AppArmor::Tree::FileMode::getWrite() const
+void AppArmor::Tree::FileMode::throwWriteAppendConflict()
 {
-  return write;
+  throw std::runtime_error("Both write and append permissions granted to same file_rule, which is not allowed.");
 }
 
-bool AppArmor::Tree::FileMode::getAppend() const
+void AppArmor::Tree::FileMode::throwInvalidTransition(std::string_view mode)
 {
-  return append;
+  std::stringstream message;
+  message << "Invalid exec transition in file mode: " << mode;
+  throw std::runtime_error(message.str());
 }
 
-bool AppArmor::Tree::FileMode::getMemoryMap() const
+AppArmor::Tree::FileMode AppArmor::Tree::FileMode::fromBits(uint8_t permissions, Transition transition)
 {
-  return memory_map;
+  FileMode mode;
+  mode.permissions = ((permissions & WRITE) != 0) ? (permissions & ~APPEND) : permissions;
+  mode.transition  = transition;
+  return mode;
 }
 
-bool AppArmor::Tree::FileMode::getLink() const
+uint8_t AppArmor::Tree::FileMode::effectivePermissions(uint8_t permissions)
 {
-  return link;
+  return ((permissions & WRITE) != 0) ? (permissions | APPEND) : permissions;
 }
 
-bool AppArmor::Tree::FileMode::getLock() const
+AppArmor::Tree::FileMode AppArmor::Tree::FileMode::operator|(const FileMode &other) const
 {
-  return lock;
-}
+  if(transition != Transition::None && other.transition != Transition::None && transition != other.transition) {
+    std::stringstream message;
+    message << "Conflicting exec transitions: " << getExecuteMode() << " and " << other.getExecuteMode();
+    throw std::runtime_error(message.str());
+  }
 
-std::string AppArmor::Tree::FileMode::getExecuteMode() const
-{
-  return execute_mode;
+  auto combined = (transition != Transition::None) ? transition : other.transition;
+  return fromBits(permissions | other.permissions, combined);
 }
 
-bool AppArmor::Tree::FileMode::empty() const
+AppArmor::Tree::FileMode &AppArmor::Tree::FileMode::operator|=(const FileMode &other)
 {
-  return !read &&
-         !write &&
-         !append &&
-         !memory_map &&
-         !link &&
-         !lock &&
-         execute_mode.empty();
+  *this = *this | other;
+  return *this;
 }
 
-bool AppArmor::Tree::FileMode::operator==(const FileMode &other) const
+AppArmor::Tree::FileMode AppArmor::Tree::FileMode::operator&(const FileMode &other) const
 {
-  return read == other.read &&
-         write == other.write &&
-         append == other.append &&
-         memory_map == other.memory_map &&
-         link == other.link &&
-         lock == other.lock &&
-         execute_mode == other.execute_mode;
+  auto bits = effectivePermissions(permissions) & effectivePermissions(other.permissions);
+  return fromBits(static_cast<uint8_t>(bits), (transition == other.transition) ? transition : Transition::None);
 }
 
-// Append a character to a stringstream if the boolean is true
-inline void conditionalAppend(std::stringstream &ss, bool value, char ch)
+AppArmor::Tree::FileMode AppArmor::Tree::FileMode::operator-(const FileMode &other) const
 {
-  if(value) {
-    ss << ch;
-  }
+  // Removing append from a write permission cannot be expressed, so write is kept
+  auto bits = permissions & ~effectivePermissions(other.permissions);
+  return fromBits(static_cast<uint8_t>(bits), (transition == other.transition) ? Transition::None : transition);
 }
 
-std::string AppArmor::Tree::FileMode::buildString(bool read, bool write, bool append, bool memory_map, bool link, bool lock, const std::string &execute_mode)
+bool AppArmor::Tree::FileMode::isSubsetOf(const FileMode &other) const
 {
-  std::stringstream ss;
-  conditionalAppend(ss, read, COD_READ_CHAR);
-  conditionalAppend(ss, write, COD_WRITE_CHAR);
-  conditionalAppend(ss, append, COD_APPEND_CHAR);
-  conditionalAppend(ss, memory_map, COD_MMAP_CHAR);
-  conditionalAppend(ss, link, COD_LINK_CHAR);
-  conditionalAppend(ss, lock, COD_LOCK_CHAR);
-  ss << execute_mode;
-
-  return ss.str();
+  auto missing = effectivePermissions(permissions) & ~effectivePermissions(other.permissions);
+  return missing == 0 && (transition == Transition::None || transition == other.transition);
 }
 
 AppArmor::Tree::FileMode::operator std::string() const
 {
-  return buildString(read, write, append, memory_map, link, lock, execute_mode);
+  static constexpr std::array<std::pair<uint8_t, char>, 6> permission_chars = {{
+    {READ, COD_READ_CHAR},
+    {WRITE, COD_WRITE_CHAR},
+    {APPEND, COD_APPEND_CHAR},
+    {MEMORY_MAP, COD_MMAP_CHAR},
+    {LINK, COD_LINK_CHAR},
+    {LOCK, COD_LOCK_CHAR}
+  }};
+
+  auto execute_mode = getExecuteMode();
+
+  std::string result;
+  result.reserve(permission_chars.size() + execute_mode.size());
+  for(const auto &[bit, ch] : permission_chars) {
+    if((permissions & bit) != 0) {
+      result.push_back(ch);
+    }
+  }
+
+  result.append(execute_mode);
+  return result;
 }
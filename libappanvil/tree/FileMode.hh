@@ -1,42 +1,239 @@
 #ifndef FILE_MODE_HH
 #define FILE_MODE_HH
 
-#include "TreeNode.hh"
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <tuple>
 
 namespace AppArmor::Tree {
-  class FileMode : public TreeNode {
+  /**
+  * @brief The permissions that a file rule grants, such as "rw" or "mrPx"
+  *
+  * @details
+  * The access permissions are the bits of a single byte and the exec transition is an enum,
+  * so comparing and combining modes never builds a string.
+  * The constructors are constexpr, so a mode written in the source can be parsed by the compiler.
+  */
+  class FileMode {
     public:
+      // What happens to the confinement when the file is executed
+      // The lowercase forms (such as "px") do not scrub the environment
+      enum class Transition : uint8_t {
+        None,
+        Exec,                    // x (only valid in deny rules)
+        Inherit,                 // ix
+        Unconfined,              // Ux
+        UnsafeUnconfined,        // ux
+        Profile,                 // Px
+        UnsafeProfile,           // px
+        Local,                   // Cx
+        UnsafeLocal,             // cx
+        ProfileInherit,          // Pix
+        UnsafeProfileInherit,    // pix
+        LocalInherit,            // Cix
+        UnsafeLocalInherit,      // cix
+        ProfileUnconfined,       // Pux
+        UnsafeProfileUnconfined, // pux
+        LocalUnconfined,         // Cux
+        UnsafeLocalUnconfined,   // cux
+        ProfileScrubUnconfined,  // PUx, which also scrubs the environment when falling back to unconfined
+        LocalScrubUnconfined     // CUx
+      };
+
       FileMode() = default;
-      explicit FileMode(const std::string &mode);
-      FileMode(bool read, bool write, bool append, bool memory_map, bool link, bool lock, const std::string &execute_mode);
+      constexpr explicit FileMode(std::string_view mode);
+      constexpr FileMode(bool read, bool write, bool append, bool memory_map, bool link, bool lock, std::string_view execute_mode);
+
+      constexpr bool getRead() const      { return (permissions & READ) != 0; }
+      constexpr bool getWrite() const     { return (permissions & WRITE) != 0; }
+      constexpr bool getAppend() const    { return (permissions & APPEND) != 0; }
+      constexpr bool getMemoryMap() const { return (permissions & MEMORY_MAP) != 0; }
+      constexpr bool getLink() const      { return (permissions & LINK) != 0; }
+      constexpr bool getLock() const      { return (permissions & LOCK) != 0; }
+      constexpr Transition getTransition() const { return transition; }
 
-      bool getRead() const;
-      bool getWrite() const;
-      bool getAppend() const;
-      bool getMemoryMap() const;
-      bool getLink() const;
-      bool getLock() const;
-      std::string getExecuteMode() const;
+      // Returns the exec transition as it is written in a profile, such as "Pix"
+      constexpr std::string_view getExecuteMode() const { return transition_names.at(static_cast<size_t>(transition)); }
 
       // Returns true if this does not grant any permission: read, write, append, ...
-      bool empty() const;
+      constexpr bool empty() const { return permissions == 0 && transition == Transition::None; }
 
-      bool operator==(const FileMode &other) const;
-      explicit operator std::string() const;
+      // Set operations, treating write as a permission that also allows appending
+      // Throws std::runtime_error if both modes have an exec transition and they differ
+      FileMode operator|(const FileMode &other) const;
+      FileMode &operator|=(const FileMode &other);
+      FileMode operator&(const FileMode &other) const;
+      FileMode operator-(const FileMode &other) const;
 
-    protected:
-      static std::string buildString(bool read, bool write, bool append, bool memory_map, bool link, bool lock, const std::string &execute_mode);
+      // Returns true if 'other' grants every permission of this mode
+      bool isSubsetOf(const FileMode &other) const;
+
+      constexpr bool operator==(const FileMode &other) const = default;
+      explicit operator std::string() const;
 
     private:
-      bool read = false;
-      bool write = false;
-      bool append = false;
-      bool memory_map = false;
-      bool link = false;
-      bool lock = false;
-      std::string execute_mode;
+      static constexpr uint8_t READ       = 1U << 0U;
+      static constexpr uint8_t WRITE      = 1U << 1U;
+      static constexpr uint8_t APPEND     = 1U << 2U;
+      static constexpr uint8_t MEMORY_MAP = 1U << 3U;
+      static constexpr uint8_t LINK       = 1U << 4U;
+      static constexpr uint8_t LOCK       = 1U << 5U;
+
+      // Letters that make up an exec transition, collected while parsing
+      static constexpr uint8_t EXEC_X         = 1U << 0U;
+      static constexpr uint8_t EXEC_INHERIT   = 1U << 1U;
+      static constexpr uint8_t EXEC_U_UNSAFE  = 1U << 2U;
+      static constexpr uint8_t EXEC_U         = 1U << 3U;
+      static constexpr uint8_t EXEC_P_UNSAFE  = 1U << 4U;
+      static constexpr uint8_t EXEC_P         = 1U << 5U;
+      static constexpr uint8_t EXEC_C_UNSAFE  = 1U << 6U;
+      static constexpr uint8_t EXEC_C         = 1U << 7U;
+
+      // What a character of a mode string stands for: a permission bit or an exec letter
+      struct CharCode {
+        uint8_t permission;
+        uint8_t exec;
+      };
+
+      static constexpr std::array<CharCode, 128> char_codes = [] {
+        std::array<CharCode, 128> codes{};
+        // Permissions and 'i'/'x' were historically matched case-insensitively
+        for(const auto &[lower, upper, code] : {
+              std::tuple{'r', 'R', CharCode{READ, 0}},
+              std::tuple{'w', 'W', CharCode{WRITE, 0}},
+              std::tuple{'a', 'A', CharCode{APPEND, 0}},
+              std::tuple{'m', 'M', CharCode{MEMORY_MAP, 0}},
+              std::tuple{'l', 'L', CharCode{LINK, 0}},
+              std::tuple{'k', 'K', CharCode{LOCK, 0}},
+              std::tuple{'x', 'X', CharCode{0, EXEC_X}},
+              std::tuple{'i', 'I', CharCode{0, EXEC_INHERIT}}}) {
+          codes.at(static_cast<size_t>(lower)) = code;
+          codes.at(static_cast<size_t>(upper)) = code;
+        }
+
+        codes.at('u') = CharCode{0, EXEC_U_UNSAFE};
+        codes.at('U') = CharCode{0, EXEC_U};
+        codes.at('p') = CharCode{0, EXEC_P_UNSAFE};
+        codes.at('P') = CharCode{0, EXEC_P};
+        codes.at('c') = CharCode{0, EXEC_C_UNSAFE};
+        codes.at('C') = CharCode{0, EXEC_C};
+        return codes;
+      }();
+
+      // Exec letters and the name of each transition, in the order of Transition
+      static constexpr std::array<uint8_t, 19> transition_letters = {
+        0,
+        EXEC_X,
+        EXEC_INHERIT | EXEC_X,
+        EXEC_U | EXEC_X,
+        EXEC_U_UNSAFE | EXEC_X,
+        EXEC_P | EXEC_X,
+        EXEC_P_UNSAFE | EXEC_X,
+        EXEC_C | EXEC_X,
+        EXEC_C_UNSAFE | EXEC_X,
+        EXEC_P | EXEC_INHERIT | EXEC_X,
+        EXEC_P_UNSAFE | EXEC_INHERIT | EXEC_X,
+        EXEC_C | EXEC_INHERIT | EXEC_X,
+        EXEC_C_UNSAFE | EXEC_INHERIT | EXEC_X,
+        EXEC_P | EXEC_U_UNSAFE | EXEC_X,
+        EXEC_P_UNSAFE | EXEC_U_UNSAFE | EXEC_X,
+        EXEC_C | EXEC_U_UNSAFE | EXEC_X,
+        EXEC_C_UNSAFE | EXEC_U_UNSAFE | EXEC_X,
+        EXEC_P | EXEC_U | EXEC_X,
+        EXEC_C | EXEC_U | EXEC_X
+      };
+
+      static constexpr std::array<std::string_view, 19> transition_names = {
+        "", "x", "ix", "Ux", "ux", "Px", "px", "Cx", "cx",
+        "Pix", "pix", "Cix", "cix", "Pux", "pux", "Cux", "cux", "PUx", "CUx"
+      };
+
+      // Reporting an error is not constexpr, so a mode that is parsed at compile time fails to compile instead
+      [[noreturn]] static void throwUnexpectedCharacter(char ch);
+      [[noreturn]] static void throwWriteAppendConflict();
+      [[noreturn]] static void throwInvalidTransition(std::string_view mode);
+
+      static constexpr Transition findTransition(uint8_t letters, std::string_view mode);
+
+      // Constructs a mode from bits that may have both write and append set, keeping only write
+      static FileMode fromBits(uint8_t permissions, Transition transition);
+
+      // Returns the permission bits, with append added if write is granted
+      static uint8_t effectivePermissions(uint8_t permissions);
+
+      uint8_t permissions = 0;
+      Transition transition = Transition::None;
   };
+
+  constexpr FileMode::Transition FileMode::findTransition(uint8_t letters, std::string_view mode)
+  {
+    for(size_t i = 0; i < transition_letters.size(); i++) {
+      if(transition_letters.at(i) == letters) {
+        return static_cast<Transition>(i);
+      }
+    }
+
+    throwInvalidTransition(mode);
+  }
+
+  constexpr FileMode::FileMode(std::string_view mode)
+  {
+    uint8_t exec_letters = 0;
+    for(const char &ch : mode) {
+      const auto index = static_cast<unsigned char>(ch);
+      const CharCode code = index < char_codes.size() ? char_codes.at(index) : CharCode{};
+      if(code.permission == 0 && code.exec == 0) {
+        throwUnexpectedCharacter(ch);
+      }
+
+      // The exec letters form a single transition, which ends with its 'x'
+      // Letters after that 'x' would start a second transition, which is rejected instead of being merged into the first,
+      // as AppArmor rejects conflicting x modifiers ("ixPx" is not "Pix"). A letter given twice ("PPx") is rejected too.
+      if(code.exec != 0 && ((exec_letters & EXEC_X) != 0 || (exec_letters & code.exec) != 0)) {
+        throwInvalidTransition(mode);
+      }
+
+      permissions |= code.permission;
+      exec_letters |= code.exec;
+    }
+
+    if((permissions & WRITE) != 0 && (permissions & APPEND) != 0) {
+      throwWriteAppendConflict();
+    }
+
+    transition = findTransition(exec_letters, mode);
+  }
+
+  constexpr FileMode::FileMode(bool read, bool write, bool append, bool memory_map, bool link, bool lock, std::string_view execute_mode)
+    : FileMode(execute_mode)
+  {
+    if(permissions != 0) {
+      // Only the letters of an exec transition are allowed here
+      throwInvalidTransition(execute_mode);
+    }
+
+    if(write && append) {
+      throwWriteAppendConflict();
+    }
+
+    permissions = (read ? READ : 0) |
+                  (write ? WRITE : 0) |
+                  (append ? APPEND : 0) |
+                  (memory_map ? MEMORY_MAP : 0) |
+                  (link ? LINK : 0) |
+                  (lock ? LOCK : 0);
+  }
+
+  inline namespace Literals {
+    // Parses a file mode at compile time, such as "rwk"_mode
+    // An invalid mode ("wa"_mode, "PCx"_mode, "uxux"_mode, ...) does not compile, instead of throwing std::runtime_error
+    consteval FileMode operator""_mode(const char *mode, size_t length)
+    {
+      return FileMode(std::string_view(mode, length));
+    }
+  } // namespace Literals
 } // namespace AppArmor::Tree
 
-#endif // FILE_MODE_HH
\ No newline at end of file
+#endif // FILE_MODE_HH
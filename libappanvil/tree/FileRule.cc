@@ -4,7 +4,7 @@
 #include <sstream>
 
 AppArmor::Tree::FileRule::FileRule(uint64_t startPos, uint64_t stopPos) 
-  : RuleNode("file", startPos, stopPos)
+  : RuleNode(RuleKind::File, startPos, stopPos)
 {   }
 
 AppArmor::Tree::FileRule::FileRule(uint64_t startPos,
@@ -12,7 +12,7 @@ AppArmor::Tree::FileRule::FileRule(uint64_t startPos,
                                    const std::string &filename,
                                    const FileMode &fileMode,
                                    const std::string &exec_target)
-  : RuleNode("file", startPos, stopPos),
+  : RuleNode(RuleKind::File, startPos, stopPos),
     filename{filename},
     exec_target{exec_target},
     fileMode{fileMode}
@@ -38,17 +38,17 @@ AppArmor::Tree::FileRule::FileRule(const std::string &filename,
   : FileRule(0, -1, filename, fileMode, exec_target)
 {   }
 
-std::string AppArmor::Tree::FileRule::getFilename() const
+const std::string &AppArmor::Tree::FileRule::getFilename() const
 {
   return filename;
 }
 
-AppArmor::Tree::FileMode AppArmor::Tree::FileRule::getFilemode() const
+const AppArmor::Tree::FileMode &AppArmor::Tree::FileRule::getFilemode() const
 {
   return fileMode;
 }
 
-std::string AppArmor::Tree::FileRule::getExecTarget() const
+const std::string &AppArmor::Tree::FileRule::getExecTarget() const
 {
   return exec_target;
 }
@@ -33,9 +33,9 @@ namespace AppArmor::Tree {
                const std::string &exec_target = "");
 
       // Accessor Methods
-      std::string getFilename() const;
-      FileMode getFilemode() const;
-      std::string getExecTarget() const;
+      const std::string &getFilename() const;
+      const FileMode &getFilemode() const;
+      const std::string &getExecTarget() const;
 
       // Checks all private memebrs are equal, including members of superclass (RuleNode)
       bool operator==(const FileRule &other) const;
@@ -0,0 +1,37 @@
+#include "GenericRule.hh"
+#include "tree/RuleNode.hh"
+
+AppArmor::Tree::GenericRule::GenericRule(Kind kind, uint64_t startPos, uint64_t stopPos)
+  : RuleNode(RuleKind::Generic, startPos, stopPos),
+    kind{kind}
+{   }
+
+AppArmor::Tree::GenericRule::Kind AppArmor::Tree::GenericRule::getKind() const
+{
+  return kind;
+}
+
+std::string_view AppArmor::Tree::GenericRule::getKindName(Kind kind)
+{
+  switch(kind) {
+    case Kind::Abi:           return "abi";
+    case Kind::Network:       return "network";
+    case Kind::Mount:         return "mount";
+    case Kind::Dbus:          return "dbus";
+    case Kind::Signal:        return "signal";
+    case Kind::Ptrace:        return "ptrace";
+    case Kind::Unix:          return "unix";
+    case Kind::Userns:        return "userns";
+    case Kind::ChangeProfile: return "change_profile";
+    case Kind::Capability:    return "capability";
+    case Kind::Conditional:   return "if";
+    case Kind::Rlimit:        return "set rlimit";
+  }
+
+  return "";
+}
+
+bool AppArmor::Tree::GenericRule::operator==(const GenericRule &other) const
+{
+  return this->kind == other.kind && RuleNode::operator==(other);
+}
@@ -0,0 +1,44 @@
+#ifndef GENERIC_RULE_HH
+#define GENERIC_RULE_HH
+
+#include "RuleNode.hh"
+
+#include <cstdint>
+#include <string_view>
+
+namespace AppArmor::Tree {
+  // A rule that the parser recognizes, but whose contents are not modelled yet (such as network or mount rules)
+  // Only its kind, prefix and position are kept, so it can still be found, moved and removed
+  class GenericRule : public RuleNode {
+    public:
+      enum class Kind : uint8_t {
+        Abi,
+        Network,
+        Mount,
+        Dbus,
+        Signal,
+        Ptrace,
+        Unix,
+        Userns,
+        ChangeProfile,
+        Capability,
+        Conditional,
+        Rlimit
+      };
+
+      GenericRule() = default;
+      GenericRule(Kind kind, uint64_t startPos, uint64_t stopPos);
+
+      Kind getKind() const;
+
+      // Returns the keyword that starts this kind of rule (such as "network")
+      static std::string_view getKindName(Kind kind);
+
+      bool operator==(const GenericRule &other) const;
+
+    private:
+      Kind kind = Kind::Abi;
+  };
+} // namespace AppArmor::Tree
+
+#endif // GENERIC_RULE_HH
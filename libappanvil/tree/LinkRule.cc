@@ -5,7 +5,7 @@
 #include <sstream>
 
 AppArmor::Tree::LinkRule::LinkRule(uint64_t startPos, uint64_t stopPos, bool isSubset, const std::string &from, const std::string &to)
-  : RuleNode("link", startPos, stopPos),
+  : RuleNode(RuleKind::Link, startPos, stopPos),
     isSubset{isSubset},
     from{from},
     to{to}
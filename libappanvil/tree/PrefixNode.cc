@@ -1,5 +1,4 @@
 #include "PrefixNode.hh"
-#include "tree/TreeNode.hh"
 
 #include <sstream>
 
@@ -1,11 +1,10 @@
 #ifndef PREFIX_NODE_HH
 #define PREFIX_NODE_HH
 
-#include "TreeNode.hh"
 #include <string>
 
 namespace AppArmor::Tree {
-  class PrefixNode : public TreeNode {
+  class PrefixNode {
     public:
       explicit PrefixNode(bool audit = DEFAULT_AUDIT, bool should_deny = DEFAULT_PERM_MODE, bool owner = DEFAULT_OWNER);
 
@@ -23,9 +22,10 @@ namespace AppArmor::Tree {
       explicit operator std::string() const;
 
     private:
-      bool audit; 
-      bool should_deny;
-      bool owner;
+      // Packed into a single byte, since every rule stores a prefix
+      bool audit : 1;
+      bool should_deny : 1;
+      bool owner : 1;
   };
 } // namespace AppArmor::Tree
 
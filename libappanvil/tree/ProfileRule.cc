@@ -1,46 +1,94 @@
 #include "ProfileRule.hh"
-#include "tree/TreeNode.hh"
 #include <cstddef>
 #include <sstream>
+#include <utility>
 
 // NOLINTNEXTLINE(google-build-using-namespace)
 using namespace AppArmor::Tree;
 
-AppArmor::Tree::ProfileRule::ProfileRule(const std::string &profile_name, const RuleList &rules)
-  : TreeNode(profile_name),
-    rules{rules}
+AppArmor::Tree::ProfileRule::ProfileRule(const std::string &profile_name, RuleList rules)
+  : profile_name{profile_name},
+    rules{std::move(rules)}
 {   }
 
-std::string AppArmor::Tree::ProfileRule::name() const
+const std::string &AppArmor::Tree::ProfileRule::name() const
 {
-  return this->getText();
+  return profile_name;
 }
 
-std::list<FileRule> AppArmor::Tree::ProfileRule::getFileRules() const
+const std::vector<FileRule> &AppArmor::Tree::ProfileRule::getFileRules() const
 {
   return rules.getFileRules();
 }
 
-std::list<LinkRule> AppArmor::Tree::ProfileRule::getLinkRules() const
+const std::vector<LinkRule> &AppArmor::Tree::ProfileRule::getLinkRules() const
 {
   return rules.getLinkRules();
 }
 
-std::list<RuleList> AppArmor::Tree::ProfileRule::getRuleList() const
+const std::vector<RuleList> &AppArmor::Tree::ProfileRule::getRuleList() const
 {
   return rules.getRuleList();
 }
 
-std::list<AbstractionRule> AppArmor::Tree::ProfileRule::getAbstractions() const
+const std::vector<AbstractionRule> &AppArmor::Tree::ProfileRule::getAbstractions() const
 {
   return rules.getAbstractions();
 }
 
-std::list<ProfileRule> AppArmor::Tree::ProfileRule::getSubprofiles() const
+const std::vector<ProfileRule> &AppArmor::Tree::ProfileRule::getSubprofiles() const
 {
   return rules.getSubprofiles();
 }
 
+const std::vector<ProfileRule> &AppArmor::Tree::ProfileRule::getHats() const
+{
+  return rules.getHats();
+}
+
+const std::vector<AllRule> &AppArmor::Tree::ProfileRule::getAllRules() const
+{
+  return rules.getAllRules();
+}
+
+const std::vector<GenericRule> &AppArmor::Tree::ProfileRule::getGenericRules() const
+{
+  return rules.getGenericRules();
+}
+
+uint64_t AppArmor::Tree::ProfileRule::getHandle() const
+{
+  return handle;
+}
+
+uint64_t AppArmor::Tree::ProfileRule::getHash() const
+{
+  return content_hash;
+}
+
+uint64_t AppArmor::Tree::ProfileRule::getStartPosition() const
+{
+  return startPos;
+}
+
+uint64_t AppArmor::Tree::ProfileRule::getEndPosition() const
+{
+  return stopPos;
+}
+
+void AppArmor::Tree::ProfileRule::setPosition(uint64_t startPos, uint64_t stopPos)
+{
+  this->startPos = startPos;
+  this->stopPos  = stopPos;
+}
+
+void AppArmor::Tree::ProfileRule::shiftPosition(int64_t offset)
+{
+  startPos += static_cast<uint64_t>(offset);
+  stopPos  += static_cast<uint64_t>(offset);
+  rules.shiftPosition(offset);
+}
+
 uint64_t AppArmor::Tree::ProfileRule::getRuleStartPosition() const
 {
   return rules.getStartPosition();
@@ -53,7 +101,7 @@ uint64_t AppArmor::Tree::ProfileRule::getRuleEndPosition() const
 
 template<class T>
 inline void AppArmor::Tree::ProfileRule::checkRuleInList(const T &obj, 
-                                               const std::list<T> &list,
+                                               const std::vector<T> &list,
                                                const std::string &class_name,
                                                const std::string &obj_name) const
 {
@@ -105,6 +153,12 @@ void AppArmor::Tree::ProfileRule::checkRuleValid(const ProfileRule &rule) const
   checkRuleInList(rule, list, "AppArmor::Tree::ProfileRule", rule.name());
 }
 
+void AppArmor::Tree::ProfileRule::checkRuleValid(const GenericRule &rule) const
+{
+  const auto &list = rules.getGenericRules();
+  checkRuleInList(rule, list, "AppArmor::Tree::GenericRule", std::string(GenericRule::getKindName(rule.getKind())));
+}
+
 bool AppArmor::Tree::ProfileRule::operator==(const ProfileRule &other) const
 {
   return this->rules == other.rules;
@@ -2,33 +2,72 @@
 #define PROFILE_RULE_HH
 
 #include "RuleList.hh"
-#include "TreeNode.hh"
 
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
+
+namespace AppArmor {
+  class Parser;
+} // namespace AppArmor
 
 namespace AppArmor::Tree {
-  class ProfileRule : protected TreeNode {
+  class ProfileRule {
     public:
-      ProfileRule(const std::string &profile_name, const RuleList &rules);
+      ProfileRule(const std::string &profile_name, RuleList rules);
       ProfileRule() = default;
 
       // Returns the name of this profile
-      std::string name() const;
+      const std::string &name() const;
+
+      // The lists below are references into this profile, not copies
+      // They stay valid until the profile is changed (such as by AppArmor::Parser::addRule())
 
       // Returns a list of RuleLists in the profile
-      std::list<RuleList> getRuleList() const;
+      const std::vector<RuleList> &getRuleList() const;
 
       // Returns a list of file rules included in the profile
-      std::list<FileRule> getFileRules() const;
+      const std::vector<FileRule> &getFileRules() const;
 
       // Returns a list of link rules included in the profile
-      std::list<LinkRule> getLinkRules() const;
+      const std::vector<LinkRule> &getLinkRules() const;
 
       // Returns a list of abstractions included in the profile
-      std::list<AbstractionRule> getAbstractions() const;
+      const std::vector<AbstractionRule> &getAbstractions() const;
 
       // Returns a list of subprofiles defined in this profile
-      std::list<ProfileRule> getSubprofiles() const;
+      const std::vector<ProfileRule> &getSubprofiles() const;
+
+      // Returns a list of hats (subprofiles starting with '^' or 'hat') defined in this profile
+      const std::vector<ProfileRule> &getHats() const;
+
+      // Returns a list of 'all' rules included in the profile
+      const std::vector<AllRule> &getAllRules() const;
+
+      // Returns a list of rules which are not modelled in detail (such as network, mount or capability rules)
+      const std::vector<GenericRule> &getGenericRules() const;
+
+      // Calls 'visitor' with every rule of the profile, in the order they appear in the file (see RuleList::visit())
+      template<class Visitor>
+      void visit(Visitor &&visitor) const
+      {
+        rules.visit(std::forward<Visitor>(visitor));
+      }
+
+      // Returns the handle that AppArmor::Parser uses to find this profile, or 0 if the profile was not created by a parser
+      // A profile gets a new handle each time it is parsed, so copies taken before a change to the profile are detected as outdated
+      uint64_t getHandle() const;
+
+      // Returns a hash of the content of this profile, or 0 if the profile was not created by a parser
+      // The hash does not depend on positions or whitespace, so equal profiles in different files have equal hashes
+      uint64_t getHash() const;
+
+      // Gets the character position where the profile starts (including any 'profile' keyword or '^')
+      uint64_t getStartPosition() const;
+
+      // Gets the character position just after the closing '}' of this profile
+      uint64_t getEndPosition() const;
 
       // Gets the character position where the rules start (after the first '{' of this profile)
       uint64_t getRuleStartPosition() const;
@@ -43,17 +82,42 @@ namespace AppArmor::Tree {
       void checkRuleValid(const RuleList &rule) const;
       void checkRuleValid(const AbstractionRule &rule) const;
       void checkRuleValid(const ProfileRule &rule) const;
+      void checkRuleValid(const GenericRule &rule) const;
 
       virtual bool operator==(const ProfileRule &other) const;
       virtual bool operator!=(const ProfileRule &other) const;
 
+    protected:
+      friend class yy::parser;
+      friend class AppArmor::Parser;
+      friend class RuleList;
+
+      void setPosition(uint64_t startPos, uint64_t stopPos);
+
+      // Moves this profile and every rule in it by 'offset' characters
+      void shiftPosition(int64_t offset);
+
+      // Calls 'visitor' with a non-const reference to every rule of the profile, in the order they appear in the file
+      template<class Visitor>
+      void visitMutable(Visitor &&visitor)
+      {
+        RuleList::visit_rules(rules, std::forward<Visitor>(visitor));
+      }
+
     private:
+      std::string profile_name;
       RuleList rules;
 
+      uint64_t startPos = 0;
+      uint64_t stopPos  = 0;
+
+      uint64_t handle = 0;
+      uint64_t content_hash = 0;
+
       // Helper methods for checkRuleValid()
       template<class T>
       inline void checkRuleInList(const T &obj, 
-                                  const std::list<T> &list,
+                                  const std::vector<T> &list,
                                   const std::string &class_name,
                                   const std::string &obj_name) const;
   };
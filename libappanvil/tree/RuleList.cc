@@ -6,63 +6,116 @@
 #include "TreeNode.hh"
 
 #include <iostream>
+#include <utility>
 
 using namespace AppArmor::Tree;
 
 AppArmor::Tree::RuleList::RuleList(uint64_t startPos)
-  : RuleNode(startPos, startPos)
+  : RuleNode(RuleKind::Block, startPos, startPos)
 {   }
 
-void AppArmor::Tree::RuleList::appendFileRule(const PrefixNode &prefix, FileRule &node)
+template<class T>
+void AppArmor::Tree::RuleList::append(std::vector<T> &list, Kind kind, T node)
+{
+  order.push_back(Entry{kind, static_cast<uint32_t>(list.size())});
+  list.push_back(std::move(node));
+}
+
+void AppArmor::Tree::RuleList::appendFileRule(const PrefixNode &prefix, FileRule node)
 {
   node.setPrefix(prefix);
-  files.push_back(node);
+  append(files, Kind::File, std::move(node));
 }
 
-void AppArmor::Tree::RuleList::appendLinkRule(const PrefixNode &prefix, LinkRule &node)
+void AppArmor::Tree::RuleList::appendLinkRule(const PrefixNode &prefix, LinkRule node)
 {
   node.setPrefix(prefix);
-  links.push_back(node);
+  append(links, Kind::Link, std::move(node));
 }
 
-void AppArmor::Tree::RuleList::appendRuleList(const PrefixNode &prefix, RuleList &node)
+void AppArmor::Tree::RuleList::appendRuleList(const PrefixNode &prefix, RuleList node)
 {
   node.setPrefix(prefix);
-  rules.push_back(node);
+  append(rules, Kind::Block, std::move(node));
+}
+
+void AppArmor::Tree::RuleList::appendAbstraction(AbstractionRule node)
+{
+  append(abstractions, Kind::Abstraction, std::move(node));
 }
 
-void AppArmor::Tree::RuleList::appendAbstraction(AbstractionRule &node)
+void AppArmor::Tree::RuleList::appendSubprofile(ProfileRule node)
 {
-  abstractions.push_back(node);
+  append(subprofiles, Kind::Subprofile, std::move(node));
 }
 
-void AppArmor::Tree::RuleList::appendSubprofile(ProfileRule &node)
+void AppArmor::Tree::RuleList::appendHat(ProfileRule node)
 {
-  subprofiles.push_back(node);
+  append(hats, Kind::Hat, std::move(node));
+}
+
+void AppArmor::Tree::RuleList::appendAllRule(AllRule node)
+{
+  append(all_rules, Kind::All, std::move(node));
+}
+
+void AppArmor::Tree::RuleList::appendGenericRule(const PrefixNode &prefix, GenericRule node)
+{
+  node.setPrefix(prefix);
+  append(generic, Kind::Generic, std::move(node));
+}
+
+void AppArmor::Tree::RuleList::shiftPosition(int64_t offset)
+{
+  RuleNode::shiftPosition(offset);
+
+  visit_rules(*this, [offset](auto &node) {
+    node.shiftPosition(offset);
+  });
 }
 
 /** Get methods **/
-std::list<FileRule> AppArmor::Tree::RuleList::getFileRules() const
+const std::vector<FileRule> &AppArmor::Tree::RuleList::getFileRules() const
 {
   return files;
 }
 
-std::list<LinkRule> AppArmor::Tree::RuleList::getLinkRules() const
+const std::vector<LinkRule> &AppArmor::Tree::RuleList::getLinkRules() const
 {
   return links;
 }
 
-std::list<RuleList> AppArmor::Tree::RuleList::getRuleList() const
+const std::vector<RuleList> &AppArmor::Tree::RuleList::getRuleList() const
 {
   return rules;
 }
 
-std::list<AbstractionRule> AppArmor::Tree::RuleList::getAbstractions() const
+const std::vector<AbstractionRule> &AppArmor::Tree::RuleList::getAbstractions() const
 {
   return abstractions;
 }
 
-std::list<ProfileRule> AppArmor::Tree::RuleList::getSubprofiles() const
+const std::vector<ProfileRule> &AppArmor::Tree::RuleList::getSubprofiles() const
 {
   return subprofiles;
 }
+
+const std::vector<ProfileRule> &AppArmor::Tree::RuleList::getHats() const
+{
+  return hats;
+}
+
+const std::vector<AllRule> &AppArmor::Tree::RuleList::getAllRules() const
+{
+  return all_rules;
+}
+
+const std::vector<GenericRule> &AppArmor::Tree::RuleList::getGenericRules() const
+{
+  return generic;
+}
+
+const std::vector<AppArmor::Tree::RuleList::Entry> &AppArmor::Tree::RuleList::getOrder() const
+{
+  return order;
+}
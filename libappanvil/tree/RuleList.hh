@@ -2,7 +2,9 @@
 #define RULE_LIST_HH
 
 #include "AbstractionRule.hh"
+#include "AllRule.hh"
 #include "FileRule.hh"
+#include "GenericRule.hh"
 #include "LinkRule.hh"
 #include "PrefixNode.hh"
 #include "RuleNode.hh"
@@ -10,6 +12,8 @@
 
 #include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace AppArmor::Tree {
   class ProfileRule;
@@ -18,27 +22,93 @@ namespace AppArmor::Tree {
       RuleList() = default;
       explicit RuleList(uint64_t startPos);
 
-      std::list<FileRule>        getFileRules() const;
-      std::list<LinkRule>        getLinkRules() const;
-      std::list<RuleList>        getRuleList() const;
-      std::list<AbstractionRule> getAbstractions() const;
-      std::list<ProfileRule>     getSubprofiles() const;
+      // The returned lists are not copies, and stay valid until this RuleList is changed
+      const std::vector<FileRule>        &getFileRules() const;
+      const std::vector<LinkRule>        &getLinkRules() const;
+      const std::vector<RuleList>        &getRuleList() const;
+      const std::vector<AbstractionRule> &getAbstractions() const;
+      const std::vector<ProfileRule>     &getSubprofiles() const;
+      const std::vector<ProfileRule>     &getHats() const;
+      const std::vector<AllRule>         &getAllRules() const;
+      const std::vector<GenericRule>     &getGenericRules() const;
+
+      // The type of list that a rule is stored in
+      using Kind = RuleKind;
+
+      // Refers to a rule by the list it is in, and its index in that list
+      struct Entry {
+        Kind kind;
+        uint32_t index;
+      };
+
+      // Returns every rule of this list (but not the rules nested inside them) in the order they appear in the file
+      const std::vector<Entry> &getOrder() const;
+
+      /**
+      * @brief Calls 'visitor' with every rule of this list, in the order they appear in the file
+      *
+      * @details
+      * The visitor is called with a const reference to the rule's own class (FileRule, LinkRule, RuleList, AbstractionRule,
+      * ProfileRule, AllRule or GenericRule), so it can be a generic lambda or a set of overloads.
+      * Each rule is found with a switch over its Kind, rather than a virtual call.
+      */
+      template<class Visitor>
+      void visit(Visitor &&visitor) const
+      {
+        visit_rules(*this, std::forward<Visitor>(visitor));
+      }
 
     protected:
       friend class yy::parser;
+      friend class ProfileRule;
 
-      void appendFileRule(const PrefixNode &prefix, FileRule &node);
-      void appendLinkRule(const PrefixNode &prefix, LinkRule &node);
-      void appendRuleList(const PrefixNode &prefix, RuleList &node);
-      void appendAbstraction(AbstractionRule &node);
-      void appendSubprofile(ProfileRule &node);
+      // Nodes are taken by value, so that the parser can move them into place instead of copying them
+      void appendFileRule(const PrefixNode &prefix, FileRule node);
+      void appendLinkRule(const PrefixNode &prefix, LinkRule node);
+      void appendRuleList(const PrefixNode &prefix, RuleList node);
+      void appendAbstraction(AbstractionRule node);
+      void appendSubprofile(ProfileRule node);
+      void appendHat(ProfileRule node);
+      void appendAllRule(AllRule node);
+      void appendGenericRule(const PrefixNode &prefix, GenericRule node);
+
+      // Moves this list and every rule in it
+      void shiftPosition(int64_t offset) override;
 
     private:
-      std::list<FileRule>         files;
-      std::list<LinkRule>         links;
-      std::list<RuleList>         rules;
-      std::list<AbstractionRule>  abstractions;
-      std::list<ProfileRule>      subprofiles;
+      // Shared by the const and non-const visits
+      // 'self' is a template parameter so the lists are only used once ProfileRule is a complete type
+      template<class Self, class Visitor>
+      static void visit_rules(Self &self, Visitor &&visitor)
+      {
+        for(const auto &entry : self.order) {
+          switch(entry.kind) {
+            case Kind::File:        visitor(self.files[entry.index]);        break;
+            case Kind::Link:        visitor(self.links[entry.index]);        break;
+            case Kind::Block:       visitor(self.rules[entry.index]);        break;
+            case Kind::Abstraction: visitor(self.abstractions[entry.index]); break;
+            case Kind::Subprofile:  visitor(self.subprofiles[entry.index]);  break;
+            case Kind::Hat:         visitor(self.hats[entry.index]);         break;
+            case Kind::All:         visitor(self.all_rules[entry.index]);    break;
+            case Kind::Generic:     visitor(self.generic[entry.index]);      break;
+          }
+        }
+      }
+
+      // Adds 'node' to the end of 'list', and records its place in 'order'
+      template<class T>
+      void append(std::vector<T> &list, Kind kind, T node);
+
+      std::vector<FileRule>         files;
+      std::vector<LinkRule>         links;
+      std::vector<RuleList>         rules;
+      std::vector<AbstractionRule>  abstractions;
+      std::vector<ProfileRule>      subprofiles;
+      std::vector<ProfileRule>      hats;
+      std::vector<AllRule>          all_rules;
+      std::vector<GenericRule>      generic;
+
+      std::vector<Entry> order;
   };
 } // namespace AppArmor::Tree
 
@@ -1,5 +1,4 @@
 #include "RuleNode.hh"
-#include "TreeNode.hh"
 
 #include <cassert>
 #include <cstdint>
@@ -7,26 +6,40 @@
 
 #define assert_things assert(startPos <= stopPos) //NOLINT(cppcoreguidelines-pro-bounds-array-to-pointer-decay,hicpp-no-array-decay)
 
+namespace {
+  // Narrows a character position to the 32 bits stored in each rule
+  // Rules that were not parsed from a file use -1 as their end position, which is kept as UINT32_MAX
+  constexpr uint64_t no_position = UINT64_MAX;
+
+  uint32_t to_offset(uint64_t pos)
+  {
+    if(pos == no_position) {
+      return UINT32_MAX;
+    }
+
+    if(pos >= UINT32_MAX) {
+      throw std::overflow_error("rule position does not fit in 32 bits, files larger than 4 GiB are not supported");
+    }
+
+    return static_cast<uint32_t>(pos);
+  }
+} // namespace
+
 // Used by Bison to create as a default value
 // Objects using this constructor should be overwritten, not used! 
 AppArmor::Tree::RuleNode::RuleNode()
-  : TreeNode("invalid"),
-    startPos{UINT64_MAX},
+  : startPos{UINT32_MAX},
     stopPos{0}
 {   }
 
 AppArmor::Tree::RuleNode::RuleNode(uint64_t startPos, uint64_t stopPos)
-  : TreeNode("rule"),
-    startPos{startPos},
-    stopPos{stopPos}
-{
-  assert_things;
-}
+  : RuleNode(RuleKind::Generic, startPos, stopPos)
+{   }
 
-AppArmor::Tree::RuleNode::RuleNode(const std::string &text, uint64_t startPos, uint64_t stopPos)
-  : TreeNode(text),
-    startPos{startPos},
-    stopPos{stopPos}
+AppArmor::Tree::RuleNode::RuleNode(RuleKind kind, uint64_t startPos, uint64_t stopPos)
+  : startPos{to_offset(startPos)},
+    stopPos{to_offset(stopPos)},
+    kind{kind}
 {
   assert_things;
 }
@@ -39,12 +52,19 @@ void AppArmor::Tree::RuleNode::setPrefix(const PrefixNode &prefix)
 
 void AppArmor::Tree::RuleNode::setStartPosition(const uint64_t &startPos)
 {
-  this->startPos = startPos;
+  this->startPos = to_offset(startPos);
 }
 
 void AppArmor::Tree::RuleNode::setStopPosition(const uint64_t &stopPos)
 {
-  this->stopPos = stopPos;
+  this->stopPos = to_offset(stopPos);
+}
+
+void AppArmor::Tree::RuleNode::shiftPosition(int64_t offset)
+{
+  // Unsigned arithmetic wraps, so this also moves the rule backwards when 'offset' is negative
+  this->startPos = to_offset(this->startPos + static_cast<uint64_t>(offset));
+  this->stopPos  = to_offset(this->stopPos + static_cast<uint64_t>(offset));
 }
 
 uint64_t AppArmor::Tree::RuleNode::getStartPosition() const
@@ -56,7 +76,7 @@ uint64_t AppArmor::Tree::RuleNode::getStartPosition() const
 uint64_t AppArmor::Tree::RuleNode::getEndPosition() const
 {
   assert_things;
-  return stopPos;
+  return (stopPos == UINT32_MAX) ? no_position : stopPos;
 }
 
 bool AppArmor::Tree::RuleNode::operator==(const RuleNode &other) const
@@ -76,7 +96,17 @@ AppArmor::Tree::RuleNode::operator std::string() const
   throw std::logic_error("RuleNode.operator std::string() is not intended to be used directly. This is intended to be used by subclasses.");
 }
 
-AppArmor::Tree::PrefixNode AppArmor::Tree::RuleNode::getPrefix() const
+const AppArmor::Tree::PrefixNode &AppArmor::Tree::RuleNode::getPrefix() const
 {
   return prefix;
 }
+
+AppArmor::Tree::RuleKind AppArmor::Tree::RuleNode::getRuleKind() const
+{
+  return kind;
+}
+
+uint64_t AppArmor::Tree::RuleNode::getHandle() const
+{
+  return handle;
+}
@@ -1,7 +1,6 @@
 #ifndef RULE_NODE_HH
 #define RULE_NODE_HH
 
-#include "TreeNode.hh"
 #include "PrefixNode.hh"
 #include <cstdint>
 #include <string>
@@ -11,17 +10,55 @@ namespace yy {
   class parser;
 } // namespace yy
 
+namespace AppArmor {
+  class Parser;
+} // namespace AppArmor
+
 namespace AppArmor::Tree {
+  class ProfileRule;
   class RuleList;
-  class RuleNode : protected TreeNode {
+
+  // The kind of a rule, which is stored in every RuleNode instead of a name
+  // Subprofile and Hat describe ProfileRules, which are listed in the same order as other rules (see RuleList::getOrder())
+  enum class RuleKind : uint8_t {
+    File,
+    Link,
+    Block,
+    Abstraction,
+    Subprofile,
+    Hat,
+    All,
+    Generic
+  };
+
+  /**
+  * @brief The common header of every rule: its kind, prefix and position
+  *
+  * @details
+  * Positions are stored as 32-bit offsets and the handle given by AppArmor::Parser as a 48-bit bit-field,
+  * so the header fits in 16 bytes besides the pointer to the virtual table.
+  * Creating a rule past the first 4 GiB of a file throws std::overflow_error.
+  */
+  class RuleNode {
     public:
       RuleNode();
       RuleNode(uint64_t startPos, uint64_t stopPos);
-      RuleNode(const std::string &text, uint64_t startPos, uint64_t stopPos);
+      RuleNode(RuleKind kind, uint64_t startPos, uint64_t stopPos);
+      virtual ~RuleNode() = default;
+
+      RuleNode(const RuleNode &) = default;
+      RuleNode(RuleNode &&) = default;
+      RuleNode &operator=(const RuleNode &) = default;
+      RuleNode &operator=(RuleNode &&) = default;
 
       uint64_t getStartPosition() const;
       uint64_t getEndPosition()  const;
-      PrefixNode getPrefix() const;
+      const PrefixNode &getPrefix() const;
+      RuleKind getRuleKind() const;
+
+      // Returns the handle that AppArmor::Parser uses to find this rule, or 0 if the rule was not created by a parser
+      // Copies of a rule share its handle, and the handle is not part of operator==
+      uint64_t getHandle() const;
 
       void setPrefix(const PrefixNode &prefix);
 
@@ -33,16 +70,25 @@ namespace AppArmor::Tree {
     protected:
       friend class yy::parser;
       friend class RuleList;
+      friend class ProfileRule;
+      friend class AppArmor::Parser;
 
       void setStartPosition(const uint64_t &startPos);
       void setStopPosition(const uint64_t &stopPos);
 
+      // Moves this rule by 'offset' characters, after text before it was inserted or erased
+      virtual void shiftPosition(int64_t offset);
+
     private:
-      PrefixNode prefix;
+      uint32_t startPos;
+      uint32_t stopPos;
+      // The prefix and kind below are placed in the two bytes that the handle leaves unused
+      uint64_t handle : 48 = 0;
 
-      uint64_t startPos;
-      uint64_t stopPos;
+      // Kept last, so that subclasses can place small members in the padding after them
+      PrefixNode prefix;
+      RuleKind kind = RuleKind::Generic;
   };
 } // namespace AppArmor::Tree
 
-#endif // RULE_NODE_HH
\ No newline at end of file
+#endif // RULE_NODE_HH
@@ -27,7 +27,7 @@ void AppArmor::Tree::TreeNode::appendChild(const TreeNode &child)
   children.push_back(child);
 }
 
-std::string AppArmor::Tree::TreeNode::getText() const
+const std::string &AppArmor::Tree::TreeNode::getText() const
 {
   return text;
 }
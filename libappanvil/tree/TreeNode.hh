@@ -20,7 +20,7 @@ namespace AppArmor::Tree {
       // Append node into the internal list of children
       void appendChild(const TreeNode &child);
 
-      std::string getText() const;
+      const std::string &getText() const;
 
       // Copy/Move assignment operator
       TreeNode& operator=(const TreeNode &) = default;
@@ -41,7 +41,7 @@ TEST_F(AddFunctionCheck, test1_add) // NOLINT
     std::list<AppArmor::Tree::FileRule> expected_file_rules;
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo", "uxuxuxuxux", expected_file_rules);
+    add_file_rule_to_profile(parser, "/bin/echo", "ux", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
     // Check that the expected file rules are present for both the old and new parser
@@ -56,7 +56,7 @@ TEST_F(AddFunctionCheck, test2_add) // NOLINT
     emplace_back(expected_file_rules, "/usr/X11R6/lib/lib*so*", "rrr");
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo", "uxuxuxuxux", expected_file_rules);
+    add_file_rule_to_profile(parser, "/bin/echo", "ux", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules, "/**");
@@ -69,7 +69,7 @@ TEST_F(AddFunctionCheck, test3_add) // NOLINT
     std::list<AppArmor::Tree::FileRule> expected_file_rules;
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo", "uxuxuxuxux", expected_file_rules);
+    add_file_rule_to_profile(parser, "/bin/echo", "ux", expected_file_rules);
     add_file_rule_to_profile(parser, "/var/log/messages", "www", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
@@ -84,7 +84,7 @@ TEST_F(AddFunctionCheck, test4_add) // NOLINT
     emplace_back(expected_file_rules, "/usr/X11R6/lib/lib*so*", "rrr");
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo", "uxuxuxuxux", expected_file_rules);
+    add_file_rule_to_profile(parser, "/bin/echo", "ux", expected_file_rules);
     add_file_rule_to_profile(parser, "/var/log/messages", "www", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
@@ -99,7 +99,7 @@ TEST_F(AddFunctionCheck, test5_add) // NOLINT
     std::list<AppArmor::Tree::FileRule> expected_file_rules2;
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo", "uxuxuxuxux", expected_file_rules1);
+    add_file_rule_to_profile(parser, "/bin/echo", "ux", expected_file_rules1);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules1, "/**");
@@ -116,7 +116,7 @@ TEST_F(AddFunctionCheck, test6_add) // NOLINT
     emplace_back(expected_file_rules2, "/usr/X11R6/lib/lib*so*", "rrr");
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo", "uxuxuxuxux", expected_file_rules1);
+    add_file_rule_to_profile(parser, "/bin/echo", "ux", expected_file_rules1);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules1, "/**");
@@ -131,7 +131,7 @@ TEST_F(AddFunctionCheck, test7_add) // NOLINT
     std::list<AppArmor::Tree::FileRule> expected_file_rules2;
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo",  "uxuxuxuxux", expected_file_rules1);
+    add_file_rule_to_profile(parser, "/bin/echo",  "ux", expected_file_rules1);
     add_file_rule_to_profile(parser, "/var/log/messages", "www", expected_file_rules2, false);
     AppArmor::Parser new_parser(temp_file);
 
@@ -149,7 +149,7 @@ TEST_F(AddFunctionCheck, test8_add) // NOLINT
     emplace_back(expected_file_rules2, "/usr/X11R6/lib/lib*so*", "rrr");
 
     AppArmor::Parser parser(filename);
-    add_file_rule_to_profile(parser, "/bin/echo",  "uxuxuxuxux", expected_file_rules1);
+    add_file_rule_to_profile(parser, "/bin/echo",  "ux", expected_file_rules1);
     add_file_rule_to_profile(parser, "/var/log/messages", "www", expected_file_rules2, false);
     AppArmor::Parser new_parser(temp_file);
 
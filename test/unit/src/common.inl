@@ -8,8 +8,9 @@
 
 namespace Common {
 
-  template<class T>
-  inline void checkRuleListsEqual(const std::list<T> &expected, const std::list<T> &observed)
+  // Works with any two containers of rules (such as the std::list of expected rules, and the std::vector returned by the parser)
+  template<class Expected, class Observed>
+  inline void checkRuleListsEqual(const Expected &expected, const Observed &observed)
   {
     EXPECT_EQ(expected.size(), observed.size()) << "There should be the same number of abstractions";
 
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "content_hash.hh"
+
+namespace ContentHashCheck {
+  uint64_t hashText(const std::string &text)
+  {
+    AppArmor::ContentHash hash;
+    hash.addText(text);
+    return hash.value();
+  }
+
+  TEST(ContentHashCheck, ignores_whitespace)
+  {
+    EXPECT_EQ(hashText("network inet tcp,"), hashText("  network \t inet\n\ntcp,\n"));
+    EXPECT_NE(hashText("network inet tcp,"), hashText("network inettcp,"));
+    EXPECT_NE(hashText("network inet tcp,"), hashText("network inet udp,"));
+  }
+
+  TEST(ContentHashCheck, separates_values)
+  {
+    // The length of each string is added, so moving a character from one string to the next changes the hash
+    AppArmor::ContentHash first;
+    first.add("ab");
+    first.add("c");
+
+    AppArmor::ContentHash second;
+    second.add("a");
+    second.add("bc");
+
+    EXPECT_NE(first.value(), second.value());
+
+    // Text ends with a terminator, so the same is true for text that is added in parts
+    AppArmor::ContentHash third;
+    third.addText("a b");
+    third.addText("c");
+
+    AppArmor::ContentHash fourth;
+    fourth.addText("a");
+    fourth.addText("b c");
+
+    EXPECT_NE(third.value(), fourth.value());
+    EXPECT_NE(AppArmor::ContentHash().value(), 0);
+  }
+} // namespace ContentHashCheck
@@ -52,7 +52,7 @@ TEST_F(EditFunctionCheck, test1_edit) // NOLINT
     std::list<AppArmor::Tree::FileRule> expected_file_rules;
 
     AppArmor::Parser parser(filename);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
     // Check that the expected file rules are present for both the old and new parser
@@ -65,10 +65,10 @@ TEST_F(EditFunctionCheck, test2_edit) // NOLINT
     std::string filename = ADDITIONAL_PROFILE_SOURCE_DIR "/edit-untouched/test2_edit.sd";
     std::list<AppArmor::Tree::FileRule> expected_file_rules;
 
-    emplace_back(expected_file_rules, "/bin/echo", "uxuxuxuxux");
+    emplace_back(expected_file_rules, "/bin/echo", "ux");
 
     AppArmor::Parser parser(filename);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules, "/**");
@@ -84,7 +84,7 @@ TEST_F(EditFunctionCheck, test3_edit) // NOLINT
     emplace_back(expected_file_rules2, "/usr/X11R6/lib/lib*so*", "rrr");
 
     AppArmor::Parser parser(filename);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules1);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules1);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules2, "/*");
@@ -97,12 +97,12 @@ TEST_F(EditFunctionCheck, test4_edit) // NOLINT
     std::list<AppArmor::Tree::FileRule> expected_file_rules1;
     std::list<AppArmor::Tree::FileRule> expected_file_rules2;
 
-    emplace_back(expected_file_rules1, "/bin/echo", "uxuxuxuxux");
+    emplace_back(expected_file_rules1, "/bin/echo", "ux");
     emplace_back(expected_file_rules2, "/usr/X11R6/lib/lib*so*", "rrr");
     emplace_back(expected_file_rules2, "/var/log/messages", "www");
 
     AppArmor::Parser parser(filename);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules1);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules1);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules1, "/**");
@@ -116,7 +116,7 @@ TEST_F(EditFunctionCheck, test5_edit_reverse) // NOLINT
     std::list<AppArmor::Tree::FileRule> expected_file_rules;
 
     AppArmor::Parser parser(filename);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules, true, false);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules, true, false);
     edit_file_rule_in_profile(parser, "/var/log/messages", "www", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
@@ -131,7 +131,7 @@ TEST_F(EditFunctionCheck, test5_edit_sequential) // NOLINT
 
     AppArmor::Parser parser(filename);
     edit_file_rule_in_profile(parser, "/var/log/messages", "www", expected_file_rules);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules, true, false);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules, true, false);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules, "/**");
@@ -146,7 +146,7 @@ TEST_F(EditFunctionCheck, test6_edit) // NOLINT
 
     AppArmor::Parser parser(filename);
     edit_file_rule_in_profile(parser, "/var/log/messages", "www", expected_file_rules1);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules2, false);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules2, false);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules1, "/**");
@@ -162,7 +162,7 @@ TEST_F(EditFunctionCheck, test7_edit) // NOLINT
 
     AppArmor::Parser parser(filename);
     edit_file_rule_in_profile(parser, "/var/log/messages", "www", dummy_list);
-    edit_file_rule_in_profile(parser, "/bin/ls", "ixixixix", expected_file_rules);
+    edit_file_rule_in_profile(parser, "/bin/ls", "ix", expected_file_rules);
     AppArmor::Parser new_parser(temp_file);
 
     check_file_rules_for_profile(parser, new_parser, expected_file_rules, "/**");
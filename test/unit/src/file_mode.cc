@@ -189,6 +189,20 @@ namespace FileModeCheck {
     check_permissions(file_mode, false, false, false, false, false, false, execute_mode);
   }
 
+  TEST(FileModeCheck, discrete_profile_execute_scrub_scrubbed_unconfined_fallback)
+  {
+    const std::string execute_mode = "PUx";
+    AppArmor::Tree::FileMode file_mode(execute_mode);
+    check_permissions(file_mode, false, false, false, false, false, false, execute_mode);
+  }
+
+  TEST(FileModeCheck, subprofile_execute_scrub_scrubbed_unconfined_fallback)
+  {
+    const std::string execute_mode = "CUx";
+    AppArmor::Tree::FileMode file_mode(execute_mode);
+    check_permissions(file_mode, false, false, false, false, false, false, execute_mode);
+  }
+
   TEST(FileModeCheck, read_2)
   {
     construct_and_check_permissions(true);
@@ -314,4 +328,91 @@ namespace FileModeCheck {
     construct_and_check_permissions(false, false, false, false, false, false, execute_mode);
   }
 
+  TEST(FileModeCheck, discrete_profile_execute_scrub_scrubbed_unconfined_fallback_2)
+  {
+    const std::string execute_mode = "PUx";
+    construct_and_check_permissions(false, false, false, false, false, false, execute_mode);
+  }
+
+  TEST(FileModeCheck, subprofile_execute_scrub_scrubbed_unconfined_fallback_2)
+  {
+    const std::string execute_mode = "CUx";
+    construct_and_check_permissions(false, false, false, false, false, false, execute_mode);
+  }
+
+  TEST(FileModeCheck, transition)
+  {
+    using Transition = AppArmor::Tree::FileMode::Transition;
+    EXPECT_EQ(AppArmor::Tree::FileMode("r").getTransition(), Transition::None);
+    EXPECT_EQ(AppArmor::Tree::FileMode("rPix").getTransition(), Transition::ProfileInherit);
+    EXPECT_EQ(AppArmor::Tree::FileMode("mcux").getTransition(), Transition::UnsafeLocalUnconfined);
+    EXPECT_EQ(AppArmor::Tree::FileMode("rPUx").getTransition(), Transition::ProfileScrubUnconfined);
+    EXPECT_EQ(AppArmor::Tree::FileMode("CUx").getTransition(), Transition::LocalScrubUnconfined);
+    EXPECT_NE(AppArmor::Tree::FileMode("PUx"), AppArmor::Tree::FileMode("Pux"));
+    EXPECT_EQ(AppArmor::Tree::FileMode("rPUx").operator std::string(), "rPUx");
+
+    // The letters of a mode may come in any order (as long as the exec transition ends with its 'x'), but are written back in canonical order
+    AppArmor::Tree::FileMode file_mode("iPmrx");
+    EXPECT_EQ(file_mode, AppArmor::Tree::FileMode("rmPix"));
+    EXPECT_EQ(file_mode.operator std::string(), "rmPix");
+  }
+
+  TEST(FileModeCheck, invalid_transition)
+  {
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("rPux2"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("Px Cx"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("PCx"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("ri"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("xPmir"));
+
+    // Two transitions conflict, rather than being merged into a third one
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("ixPx"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("ruxPx"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("PPx"));
+
+    // Repeated transitions are not folded into one
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("uxuxux"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode("xx"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode(false, false, false, false, false, false, "ixix"));
+    EXPECT_ANY_THROW(AppArmor::Tree::FileMode(false, false, false, false, false, false, "rix"));
+  }
+
+  TEST(FileModeCheck, set_operations)
+  {
+    using AppArmor::Tree::FileMode;
+    EXPECT_EQ(FileMode("r") | FileMode("mix"), FileMode("rmix"));
+    EXPECT_EQ(FileMode("rw") & FileMode("rk"), FileMode("r"));
+    EXPECT_EQ(FileMode("rwlk") - FileMode("wl"), FileMode("rk"));
+    EXPECT_TRUE((FileMode("rPx") - FileMode("Px")).getExecuteMode().empty());
+    EXPECT_TRUE((FileMode("rPx") & FileMode("Cx")).getExecuteMode().empty());
+
+    // Write also grants append, so combining them keeps only write
+    EXPECT_EQ(FileMode("w") | FileMode("a"), FileMode("w"));
+    EXPECT_EQ(FileMode("w") & FileMode("ra"), FileMode("a"));
+    EXPECT_TRUE(FileMode("a").isSubsetOf(FileMode("rw")));
+    EXPECT_FALSE(FileMode("w").isSubsetOf(FileMode("ra")));
+
+    EXPECT_TRUE(FileMode("rix").isSubsetOf(FileMode("rmix")));
+    EXPECT_FALSE(FileMode("rix").isSubsetOf(FileMode("rmPx")));
+    EXPECT_TRUE(FileMode().isSubsetOf(FileMode()));
+
+    FileMode aggregate;
+    aggregate |= FileMode("r");
+    aggregate |= FileMode("mPx");
+    EXPECT_EQ(aggregate, FileMode("rmPx"));
+    EXPECT_ANY_THROW(aggregate | FileMode("Cx"));
+  }
+
+  TEST(FileModeCheck, literal)
+  {
+    using namespace AppArmor::Tree::Literals;
+
+    // Literals are parsed by the compiler, so these are checked before the test runs
+    static_assert("rwk"_mode.getRead() && "rwk"_mode.getWrite() && "rwk"_mode.getLock());
+    static_assert("mrCix"_mode.getTransition() == AppArmor::Tree::FileMode::Transition::LocalInherit);
+    static_assert("iPx"_mode == "Pix"_mode);
+
+    EXPECT_EQ("rwk"_mode, AppArmor::Tree::FileMode("rwk"));
+    EXPECT_EQ("mrCix"_mode.operator std::string(), "rmCix");
+  }
 } // namespace FileModeCheck
@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "aa-generate.h"
+#include "apparmor_parser.hh"
+
+using namespace AppArmor::Literals;
+
+class GeneratorCheck : public ::testing::Test {
+public:
+  void TearDown() override
+  {
+    std::ignore = std::remove(temp_file.c_str());
+  }
+
+protected:
+  // Writes a generated profile to 'temp_file' and parses it
+  AppArmor::Parser parse_generated(const AppArmorGenerate::options &opts)
+  {
+    std::ofstream stream(temp_file);
+    AppArmorGenerate::generate(opts, stream);
+    stream.close();
+
+    return AppArmor::Parser(temp_file);
+  }
+
+  // File that will be written to and read from temporarily for testing purposes
+  std::string temp_file = ADDITIONAL_PROFILE_SOURCE_DIR "/generated.sd"; // NOLINT
+};
+
+namespace {
+  AppArmorGenerate::options every_kind_of_rule()
+  {
+    AppArmorGenerate::options opts;
+    opts.seed         = 42;
+    opts.profiles     = 3;
+    opts.file_rules   = 40;
+    opts.link_rules   = 5;
+    opts.abstractions = 4;
+    opts.hats         = 2;
+    opts.subprofiles  = 2;
+    opts.conditionals = 3;
+    opts.variables    = 3;
+    return opts;
+  }
+} // namespace
+
+namespace GeneratorTests {
+  TEST_F(GeneratorCheck, deterministic)
+  {
+    auto opts = every_kind_of_rule();
+    EXPECT_EQ(AppArmorGenerate::generate(opts), AppArmorGenerate::generate(opts));
+
+    auto other_seed = opts;
+    other_seed.seed++;
+    EXPECT_NE(AppArmorGenerate::generate(opts), AppArmorGenerate::generate(other_seed));
+  }
+
+  TEST_F(GeneratorCheck, one_exec_transition_per_path)
+  {
+    auto opts = every_kind_of_rule();
+    opts.profiles   = 1;
+    opts.file_rules = 20000;
+
+    // Every rule for the same path must use the same exec transition, and paths with a glob cannot be executed
+    std::map<std::string, std::string> transitions;
+    std::istringstream stream(AppArmorGenerate::generate(opts));
+    std::string line;
+    size_t repeated = 0;
+    while(std::getline(stream, line)) {
+      std::istringstream words(line);
+      std::string path;
+      std::string mode;
+      if(!(words >> path >> mode) || (path.front() != '/' && path.front() != '@') || mode.back() != ',') {
+        continue;
+      }
+
+      auto exec = mode.find('x');
+      std::string transition = (exec == std::string::npos) ? "" : mode.substr(exec - 1, 2);
+      if(path.find('*') != std::string::npos) {
+        EXPECT_EQ(transition, "") << path;
+      }
+
+      auto [found, inserted] = transitions.emplace(path, transition);
+      EXPECT_EQ(found->second, transition) << path;
+      repeated += inserted ? 0 : 1;
+    }
+
+    EXPECT_GT(repeated, 0);
+  }
+
+  TEST_F(GeneratorCheck, generated_profiles_parse)
+  {
+    auto opts = every_kind_of_rule();
+
+    AppArmor::Parser parser = parse_generated(opts);
+    auto profile_list = parser.getProfileList();
+    ASSERT_EQ(profile_list.size(), opts.profiles);
+
+    for(const auto &profile : profile_list) {
+      EXPECT_EQ(profile.getFileRules().size(), opts.file_rules);
+      EXPECT_EQ(profile.getLinkRules().size(), opts.link_rules);
+      EXPECT_EQ(profile.getAbstractions().size(), opts.abstractions);
+      EXPECT_EQ(profile.getSubprofiles().size(), opts.subprofiles);
+      EXPECT_EQ(profile.getHats().size(), opts.hats);
+    }
+  }
+
+  TEST_F(GeneratorCheck, edit_generated_profile)
+  {
+    auto opts = every_kind_of_rule();
+
+    AppArmor::Parser parser = parse_generated(opts);
+    auto profile = parser.getProfileList().back();
+    auto rule = profile.getFileRules().front();
+
+    ASSERT_NO_THROW(parser.removeRule(profile, rule));
+
+    profile = parser.getProfileList().back();
+    EXPECT_EQ(profile.getFileRules().size(), opts.file_rules - 1);
+
+    ASSERT_NO_THROW(parser.addRule(profile, AppArmor::FileRule("/generated/added", "r"_mode)));
+    EXPECT_EQ(parser.getProfileList().back().getFileRules().size(), opts.file_rules);
+  }
+
+  TEST_F(GeneratorCheck, edit_matches_full_parse)
+  {
+    auto opts = every_kind_of_rule();
+
+    // Editing the first profile only parses that profile again, and moves the others
+    AppArmor::Parser parser = parse_generated(opts);
+    auto profile = parser.getProfileList().front();
+    auto rule = profile.getFileRules().back();
+    ASSERT_NO_THROW(parser.editRule(profile, rule, AppArmor::FileRule("/generated/a/much/longer/path/than/before", "rw"_mode)));
+
+    AppArmor::Parser expected = parse_generated(opts);
+    expected.updateFromString(parser.operator std::string());
+
+    auto profile_list = parser.getProfileList();
+    auto expected_list = expected.getProfileList();
+    ASSERT_EQ(profile_list.size(), expected_list.size());
+
+    auto expected_profile = expected_list.begin();
+    for(const auto &edited : profile_list) {
+      EXPECT_EQ(edited.getStartPosition(), expected_profile->getStartPosition());
+      EXPECT_EQ(edited.getEndPosition(), expected_profile->getEndPosition());
+      EXPECT_EQ(edited.getFileRules(), expected_profile->getFileRules());
+      EXPECT_EQ(edited, *expected_profile);
+      expected_profile++;
+    }
+
+    const auto &map = parser.getSourceMap();
+    const auto &expected_map = expected.getSourceMap();
+    ASSERT_EQ(map.getLineCount(), expected_map.getLineCount());
+    for(uint64_t line = 1; line <= map.getLineCount(); line++) {
+      EXPECT_EQ(map.getLineStart(line), expected_map.getLineStart(line)) << "line " << line;
+    }
+  }
+
+  TEST_F(GeneratorCheck, transaction_matches_single_edits)
+  {
+    auto opts = every_kind_of_rule();
+
+    // Queue changes to every profile, and apply them at once
+    AppArmor::Parser parser = parse_generated(opts);
+    auto transaction = parser.beginTransaction();
+    for(auto profile : parser.getProfileList()) {
+      auto rules = profile.getFileRules();
+      transaction.removeRule(profile, rules.front());
+      transaction.editRule(profile, rules.back(), AppArmor::FileRule("/generated/edited", "rw"_mode));
+      transaction.addRule(profile, AppArmor::FileRule("/generated/first", "r"_mode));
+      transaction.addRule(profile, AppArmor::FileRule("/generated/second", "w"_mode));
+    }
+    ASSERT_EQ(transaction.size(), opts.profiles * 4);
+
+    std::stringstream output;
+    ASSERT_NO_THROW(transaction.commit(output));
+    EXPECT_EQ(transaction.size(), 0);
+    EXPECT_EQ(output.str(), parser.operator std::string());
+    EXPECT_TRUE(parser.hasChanges());
+
+    // Make the same changes one at a time
+    AppArmor::Parser expected = parse_generated(opts);
+    auto profile_count = expected.getProfileList().size();
+    for(size_t i = 0; i < profile_count; i++) {
+      auto profile = *std::next(expected.getProfileList().begin(), i);
+      auto rule = profile.getFileRules().back();
+      expected.editRule(profile, rule, AppArmor::FileRule("/generated/edited", "rw"_mode));
+
+      profile = *std::next(expected.getProfileList().begin(), i);
+      rule = profile.getFileRules().front();
+      expected.removeRule(profile, rule);
+
+      profile = *std::next(expected.getProfileList().begin(), i);
+      expected.addRule(profile, AppArmor::FileRule("/generated/first", "r"_mode));
+
+      profile = *std::next(expected.getProfileList().begin(), i);
+      expected.addRule(profile, AppArmor::FileRule("/generated/second", "w"_mode));
+    }
+
+    EXPECT_EQ(parser.operator std::string(), expected.operator std::string());
+    EXPECT_EQ(parser.getProfileList(), expected.getProfileList());
+  }
+
+  TEST_F(GeneratorCheck, transaction_rolls_back)
+  {
+    auto opts = every_kind_of_rule();
+
+    AppArmor::Parser parser = parse_generated(opts);
+    const std::string original = parser.operator std::string();
+    auto profile = parser.getProfileList().front();
+    auto rule = profile.getFileRules().front();
+
+    // Removing the same rule twice overlaps
+    auto overlapping = parser.beginTransaction();
+    overlapping.addRule(profile, AppArmor::FileRule("/generated/added", "r"_mode));
+    overlapping.removeRule(profile, rule);
+    overlapping.removeRule(profile, rule);
+    EXPECT_THROW(overlapping.commit(), std::domain_error);
+
+    EXPECT_EQ(parser.operator std::string(), original);
+    EXPECT_FALSE(parser.hasChanges());
+
+    // A change that does not parse undoes every other change
+    auto broken = parser.beginTransaction();
+    broken.addRule(profile, AppArmor::FileRule("/generated/added", "r"_mode));
+    broken.addRule(profile, AppArmor::FileRule("/generated/broken }", "r"_mode));
+    EXPECT_ANY_THROW(broken.commit());
+
+    EXPECT_EQ(parser.operator std::string(), original);
+    EXPECT_FALSE(parser.hasChanges());
+    EXPECT_EQ(parser.getProfileList().front().getFileRules().size(), opts.file_rules);
+  }
+
+  TEST_F(GeneratorCheck, transaction_outdated_by_parser_change)
+  {
+    auto opts = every_kind_of_rule();
+
+    AppArmor::Parser parser = parse_generated(opts);
+    auto profile = parser.getProfileList().front();
+    auto rules = profile.getFileRules();
+
+    // Changing the parser directly moves the text that the queued change points to
+    auto transaction = parser.beginTransaction();
+    transaction.removeRule(profile, rules.back());
+    parser.removeRule(profile, rules.front());
+    const std::string changed = parser.operator std::string();
+
+    EXPECT_THROW(transaction.commit(), std::domain_error);
+    EXPECT_EQ(transaction.size(), 0);
+    EXPECT_EQ(parser.operator std::string(), changed);
+
+    // A transaction started after the change can be committed
+    profile = parser.getProfileList().front();
+    auto current = parser.beginTransaction();
+    current.removeRule(profile, profile.getFileRules().back());
+    ASSERT_NO_THROW(current.commit());
+    EXPECT_EQ(parser.getProfileList().front().getFileRules().size(), opts.file_rules - 2);
+  }
+} // namespace GeneratorTests
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+#include "apparmor_parser.hh"
+
+namespace HistoryCheck {
+  const std::string filename = ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test3_remove.sd";
+
+  // Checks that the profiles of 'parser' are the same as those of a parser of the same text
+  void expect_parsed(const AppArmor::Parser &parser)
+  {
+    AppArmor::Parser expected(filename);
+    expected.updateFromString(parser.operator std::string());
+    EXPECT_EQ(parser.getProfileList(), expected.getProfileList());
+  }
+
+  TEST(HistoryCheck, undo_and_redo)
+  {
+    AppArmor::Parser parser(filename);
+    const std::string original = parser.operator std::string();
+    EXPECT_FALSE(parser.canUndo());
+    EXPECT_FALSE(parser.undo());
+
+    auto back = parser.getProfileList().back();
+    parser.addRule(back, AppArmor::FileRule("/added", "rw"));
+    const std::string added = parser.operator std::string();
+
+    auto front = parser.getProfileList().front();
+    parser.removeRule(front, front.getFileRules().front());
+    const std::string removed = parser.operator std::string();
+
+    ASSERT_TRUE(parser.undo());
+    EXPECT_EQ(parser.operator std::string(), added);
+    expect_parsed(parser);
+
+    ASSERT_TRUE(parser.undo());
+    EXPECT_EQ(parser.operator std::string(), original);
+    EXPECT_FALSE(parser.canUndo());
+    EXPECT_FALSE(parser.hasChanges());
+
+    ASSERT_TRUE(parser.redo());
+    ASSERT_TRUE(parser.redo());
+    EXPECT_EQ(parser.operator std::string(), removed);
+    EXPECT_FALSE(parser.redo());
+    expect_parsed(parser);
+
+    // A new change forgets the changes that were undone
+    ASSERT_TRUE(parser.undo());
+    EXPECT_TRUE(parser.canRedo());
+    parser.updateFromString(original);
+    EXPECT_FALSE(parser.canRedo());
+
+    ASSERT_TRUE(parser.undo());
+    EXPECT_EQ(parser.operator std::string(), added);
+  }
+
+  TEST(HistoryCheck, transactions_and_patches)
+  {
+    AppArmor::Parser parser(filename);
+    const std::string original = parser.operator std::string();
+
+    // A transaction is undone as one change
+    auto transaction = parser.beginTransaction();
+    auto front = parser.getProfileList().front();
+    auto back  = parser.getProfileList().back();
+    transaction.removeRule(front, front.getFileRules().front());
+    transaction.addRule(back, AppArmor::FileRule("/added", "rw"));
+    transaction.commit();
+
+    ASSERT_TRUE(parser.undo());
+    EXPECT_EQ(parser.operator std::string(), original);
+    expect_parsed(parser);
+
+    // An empty transaction is not a change, so the undone change can still be redone
+    parser.beginTransaction().commit();
+    EXPECT_TRUE(parser.canRedo());
+    EXPECT_FALSE(parser.canUndo());
+
+    // Neither is a patch without splices
+    parser.applyPatch(AppArmor::Patch(AppArmor::Patch::hash(parser.operator std::string()), {}));
+    EXPECT_TRUE(parser.canRedo());
+    EXPECT_FALSE(parser.canUndo());
+
+    // Undoing writes a patch like any other change
+    ASSERT_TRUE(parser.redo());
+    parser.setOutputMode(AppArmor::OutputMode::Patch);
+    AppArmor::Parser receiver = parser;
+
+    std::stringstream output;
+    ASSERT_TRUE(parser.undo(output));
+    receiver.applyPatch(AppArmor::Patch::read(output));
+    EXPECT_EQ(receiver.operator std::string(), original);
+  }
+
+  TEST(HistoryCheck, limit)
+  {
+    AppArmor::Parser parser(filename);
+    auto back = parser.getProfileList().back();
+    parser.addRule(back, AppArmor::FileRule("/added", "rw"));
+    EXPECT_TRUE(parser.canUndo());
+
+    parser.setHistoryLimit(0);
+    EXPECT_FALSE(parser.canUndo());
+
+    back = parser.getProfileList().back();
+    parser.addRule(back, AppArmor::FileRule("/another", "r"));
+    EXPECT_FALSE(parser.canUndo());
+
+    // Cancelling forgets the history
+    parser.setHistoryLimit(1 << 20);
+    back = parser.getProfileList().back();
+    parser.addRule(back, AppArmor::FileRule("/third", "r"));
+    parser.cancelChanges();
+    EXPECT_FALSE(parser.canUndo());
+  }
+
+  TEST(HistoryCheck, small_change_to_large_file)
+  {
+    // A file with more text than the default limit of the history
+    std::string large = "/usr/bin/large {\n";
+    for(size_t i = 0; large.size() <= (1 << 20); i++) {
+      large += "  /generated/large/path/" + std::to_string(i) + " r,\n";
+    }
+    large += "}\n";
+
+    AppArmor::Parser parser(filename);
+    parser.updateFromString(large);
+
+    // Only the text that changed is kept, so a small change to the large file can still be undone
+    std::string edited = large;
+    edited.replace(edited.find(" r,"), 3, " rw,");
+    parser.updateFromString(edited);
+    ASSERT_TRUE(parser.canUndo());
+
+    ASSERT_TRUE(parser.undo());
+    EXPECT_EQ(parser.operator std::string(), large);
+
+    ASSERT_TRUE(parser.redo());
+    EXPECT_EQ(parser.operator std::string(), edited);
+  }
+} // namespace HistoryCheck
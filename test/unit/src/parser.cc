@@ -1,4 +1,7 @@
 #include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "common.inl"
 #include "parser.hh"
@@ -46,3 +49,150 @@ TEST_P(ParserCheck, fail_gracefully)
 }
 
 INSTANTIATE_TEST_SUITE_P(Parameterized, ParserCheck, testing::ValuesIn(broken_profiles));
+
+// Files should be parsed independently, and the results should be in the same order as the paths
+TEST(ParserCheck, parse_all)
+{
+  std::vector<std::string> paths;
+  for(int i = 1; i <= 8; i++) {
+    paths.push_back(ADDITIONAL_PROFILE_SOURCE_DIR "/add-untouched/test" + std::to_string(i) + "_add.sd");
+  }
+  for(const auto &broken : broken_profiles) {
+    paths.insert(paths.begin() + 2, ADDITIONAL_PROFILE_SOURCE_DIR + broken);
+  }
+
+  auto results = AppArmor::Parser::parseAll(paths, 3);
+  ASSERT_EQ(results.size(), paths.size());
+
+  for(size_t i = 0; i < paths.size(); i++) {
+    const auto &result = results[i];
+    EXPECT_EQ(result.path, paths[i]);
+
+    if(paths[i].find("/broken/") != std::string::npos) {
+      EXPECT_FALSE(result.parser.has_value()) << paths[i] << " should not parse";
+      EXPECT_FALSE(result.error.empty());
+    } else {
+      ASSERT_TRUE(result.parser.has_value()) << result.error;
+      EXPECT_TRUE(result.error.empty());
+
+      AppArmor::Parser sequential(paths[i]);
+      EXPECT_EQ(result.parser->getProfileList(), sequential.getProfileList());
+    }
+  }
+}
+
+// Read-only accessors should return the parser's own data, rather than copies
+TEST(ParserCheck, accessors_do_not_copy)
+{
+  AppArmor::Parser parser(ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test2_remove.sd");
+
+  const auto &profile_list = parser.getProfileList();
+  ASSERT_EQ(&profile_list, &parser.getProfileList());
+  ASSERT_FALSE(profile_list.empty());
+
+  const auto &profile = profile_list.front();
+  const auto &file_rules = profile.getFileRules();
+  EXPECT_EQ(&file_rules, &profile.getFileRules());
+  ASSERT_FALSE(file_rules.empty());
+
+  const auto &rule = file_rules.front();
+  EXPECT_EQ(&rule.getFilename(), &file_rules.front().getFilename());
+  EXPECT_EQ(&profile.name(), &profile_list.front().name());
+}
+
+// Profiles and rules are found by handle, and handles become outdated once the profile they belong to is changed
+TEST(ParserCheck, handles)
+{
+  AppArmor::Parser parser(ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test3_remove.sd");
+  ASSERT_EQ(parser.getProfileList().size(), 2);
+
+  auto front = parser.getProfileList().front();
+  auto back  = parser.getProfileList().back();
+  ASSERT_NE(front.getHandle(), 0);
+  ASSERT_NE(front.getHandle(), back.getHandle());
+
+  auto front_rule = front.getFileRules().front();
+  auto back_rule  = back.getFileRules().front();
+  ASSERT_NE(front_rule.getHandle(), 0);
+  ASSERT_NE(front_rule.getHandle(), back_rule.getHandle());
+
+  // A copy of the parser finds the same handles, without sharing changes with the original
+  AppArmor::Parser copy = parser;
+  EXPECT_EQ(copy.getHash(), parser.getHash());
+  EXPECT_EQ(copy.getProfileList().front().getHash(), front.getHash());
+  ASSERT_NO_THROW(copy.removeRule(front, front_rule));
+  EXPECT_NE(copy.operator std::string(), parser.operator std::string());
+
+  // The changed profile is outdated, but the other profile is still found after moving
+  EXPECT_THROW(copy.removeRule(front, front_rule), std::domain_error);
+  EXPECT_THROW(copy.addRule(front, AppArmor::FileRule("/added", "r")), std::domain_error);
+  ASSERT_NO_THROW(copy.removeRule(back, back_rule));
+
+  AppArmor::Parser expected = parser;
+  auto expected_front = expected.getProfileList().front();
+  expected.removeRule(expected_front, expected_front.getFileRules().front());
+  auto expected_back = expected.getProfileList().back();
+  expected.removeRule(expected_back, expected_back.getFileRules().front());
+  EXPECT_EQ(copy.operator std::string(), expected.operator std::string());
+
+  // A rule is only found in the profile it belongs to, and handles of another parser are never found
+  EXPECT_THROW(parser.removeRule(back, front_rule), std::domain_error);
+  AppArmor::Parser other(ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test3_remove.sd");
+  EXPECT_THROW(other.removeRule(front, front_rule), std::domain_error);
+
+  // Rules that were not created by a parser have no handle
+  EXPECT_EQ(AppArmor::FileRule("/added", "r").getHandle(), 0);
+}
+
+// Profiles are hashed by their content, so the hash does not depend on how the file was changed
+TEST(ParserCheck, content_hashes)
+{
+  auto profile = ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test3_remove.sd";
+  AppArmor::Parser parser(profile);
+  AppArmor::Parser same(profile);
+  ASSERT_NE(parser.getHash(), 0);
+  EXPECT_EQ(parser.getHash(), same.getHash());
+  EXPECT_NE(parser.getProfileList().front().getHash(), parser.getProfileList().back().getHash());
+  EXPECT_FALSE(parser.hasChanges());
+
+  // Removing a rule gives the same hash as parsing the result from scratch
+  auto front = parser.getProfileList().front();
+  parser.removeRule(front, front.getFileRules().front());
+  EXPECT_NE(parser.getHash(), same.getHash());
+  EXPECT_TRUE(parser.hasChanges());
+
+  same.updateFromString(parser.operator std::string());
+  EXPECT_EQ(parser.getHash(), same.getHash());
+
+  // Changing only whitespace keeps the hash, but is still a change to the file
+  AppArmor::Parser spaced(profile);
+  std::string text = spaced.operator std::string();
+  text.replace(text.find('{'), 1, "  {\n\n");
+  spaced.updateFromString(text);
+  EXPECT_EQ(spaced.getHash(), AppArmor::Parser(profile).getHash());
+  EXPECT_TRUE(spaced.hasChanges());
+
+  // The text outside of the profiles is part of the policy, but its comments are not
+  AppArmor::Parser outside(profile);
+  outside.updateFromString("# A comment before the profiles\n" + outside.operator std::string());
+  EXPECT_EQ(outside.getHash(), AppArmor::Parser(profile).getHash());
+
+  outside.updateFromString("@{GEN_VAR}=/usr/lib/generated\n" + outside.operator std::string());
+  EXPECT_NE(outside.getHash(), AppArmor::Parser(profile).getHash());
+
+  // Text inserted right at the start of a profile is outside of it
+  AppArmor::Parser patched(profile);
+  const auto start = patched.getProfileList().front().getStartPosition();
+  const std::string variable = "@{GEN_VAR}=/usr/lib/generated\n";
+  patched.applyPatch(AppArmor::Patch(AppArmor::Patch::hash(patched.operator std::string()), {{start, 0, variable}}));
+
+  AppArmor::Parser expected(profile);
+  expected.updateFromString(patched.operator std::string());
+  EXPECT_EQ(patched.getHash(), expected.getHash());
+  EXPECT_NE(patched.getHash(), AppArmor::Parser(profile).getHash());
+  EXPECT_EQ(patched.getProfileList().front().getStartPosition(), start + variable.size());
+
+  patched.undo();
+  EXPECT_EQ(patched.getHash(), AppArmor::Parser(profile).getHash());
+  EXPECT_FALSE(patched.hasChanges());
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "apparmor_parser.hh"
+#include "patch.hh"
+
+namespace PatchCheck {
+  TEST(PatchCheck, write_and_read)
+  {
+    const std::string base = "/usr/bin/foo {\n  /etc/passwd r,\n}\n";
+    AppArmor::Patch patch(AppArmor::Patch::hash(base), {{2, 3, ""}, {17, 14, "/etc/group rw,"}});
+
+    // The text of a splice may contain anything, including line breaks and digits
+    std::stringstream stream;
+    stream << patch << AppArmor::Patch(0, {{0, 0, "12 3\n"}});
+    EXPECT_EQ(AppArmor::Patch::read(stream), patch);
+    EXPECT_EQ(AppArmor::Patch::read(stream).getSplices().front().text, "12 3\n");
+
+    std::string text = base;
+    patch.apply(text);
+    EXPECT_EQ(text, "/ubin/foo {\n  /etc/group rw,\n}\n");
+
+    // The same text is patched in a piece table
+    AppArmor::PieceTable table(base);
+    patch.apply(table);
+    EXPECT_EQ(table.operator std::string(), text);
+    EXPECT_EQ(AppArmor::Patch::hash(table), AppArmor::Patch::hash(text));
+  }
+
+  TEST(PatchCheck, invalid_patches)
+  {
+    const std::string base = "/usr/bin/foo { }";
+    std::string text = base;
+
+    // The patch was made for other text, or was already applied
+    EXPECT_THROW(AppArmor::Patch(AppArmor::Patch::hash("other"), {}).apply(text), std::domain_error);
+    EXPECT_THROW(AppArmor::Patch(AppArmor::Patch::hash(base), {{10, 10, ""}}).apply(text), std::out_of_range);
+    EXPECT_THROW(AppArmor::Patch(AppArmor::Patch::hash(base), {{4, 4, ""}, {6, 1, ""}}).apply(text), std::out_of_range);
+    EXPECT_EQ(text, base);
+
+    std::stringstream missing_header("1 2 3\nabc");
+    EXPECT_THROW(AppArmor::Patch::read(missing_header), std::runtime_error);
+
+    std::stringstream truncated("patch 1f 1\n0 0 10\nabc");
+    EXPECT_THROW(AppArmor::Patch::read(truncated), std::runtime_error);
+
+    // A text size larger than the input is not allocated up front, and the format of the stream is kept
+    std::stringstream oversized("patch 1f 1\n0 0 18446744073709551615\nabc");
+    oversized.setf(std::ios::oct, std::ios::basefield);
+    EXPECT_THROW(AppArmor::Patch::read(oversized), std::runtime_error);
+    EXPECT_EQ(oversized.flags() & std::ios::basefield, std::ios::oct);
+  }
+
+  // A parser in patch mode writes only the change, which keeps a parser of the same file elsewhere up to date
+  TEST(PatchCheck, parser_output)
+  {
+    const std::string filename = ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test3_remove.sd";
+    AppArmor::Parser sender(filename);
+    AppArmor::Parser receiver(filename);
+    sender.setOutputMode(AppArmor::OutputMode::Patch);
+
+    auto profile = sender.getProfileList().back();
+    std::stringstream output;
+    sender.addRule(profile, AppArmor::FileRule("/added", "rw"), output);
+    EXPECT_LT(output.str().size(), sender.operator std::string().size());
+
+    auto patch = AppArmor::Patch::read(output);
+    receiver.applyPatch(patch);
+    EXPECT_EQ(receiver.operator std::string(), sender.operator std::string());
+    EXPECT_EQ(receiver.getProfileList(), sender.getProfileList());
+    EXPECT_THROW(receiver.applyPatch(patch), std::domain_error);
+
+    // Changes from a transaction are written as one patch
+    auto transaction = sender.beginTransaction();
+    auto front = sender.getProfileList().front();
+    auto back  = sender.getProfileList().back();
+    transaction.removeRule(front, front.getFileRules().front());
+    transaction.removeRule(back, back.getFileRules().back());
+
+    std::stringstream transaction_output;
+    transaction.commit(transaction_output);
+    patch = AppArmor::Patch::read(transaction_output);
+    EXPECT_EQ(patch.getSplices().size(), 2);
+
+    receiver.applyPatch(patch);
+    EXPECT_EQ(receiver.operator std::string(), sender.operator std::string());
+  }
+} // namespace PatchCheck
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "piece_table.hh"
+
+namespace PieceTableCheck {
+  // Joins the pieces of a range back into one string
+  std::string join(const AppArmor::PieceTable &table, uint64_t pos, uint64_t length)
+  {
+    std::string result;
+    for(const auto &piece : table.pieces(pos, length)) {
+      result.append(piece);
+    }
+    return result;
+  }
+
+  TEST(PieceTableCheck, matches_string_edits)
+  {
+    const std::string original = "/usr/bin/foo {\n  /etc/passwd r,\n}\n";
+    std::string expected = original;
+    AppArmor::PieceTable table(original);
+
+    std::mt19937 random(42);
+    for(int i = 0; i < 500; i++) {
+      uint64_t pos    = random() % (expected.size() + 1);
+      uint64_t length = (random() % 2 == 0) ? 0 : random() % (expected.size() - pos + 1);
+      std::string text(random() % 6, static_cast<char>('a' + random() % 26));
+
+      expected.replace(pos, length, text);
+      table.replace(pos, length, text);
+
+      ASSERT_EQ(table.operator std::string(), expected);
+      ASSERT_EQ(table.size(), expected.size());
+
+      // Any range should be readable without joining the whole document
+      uint64_t range_pos    = random() % (expected.size() + 1);
+      uint64_t range_length = random() % (expected.size() - range_pos + 1);
+      ASSERT_EQ(join(table, range_pos, range_length), expected.substr(range_pos, range_length));
+    }
+
+    std::stringstream stream;
+    stream << table;
+    EXPECT_EQ(stream.str(), expected);
+    EXPECT_EQ(table.original(), original);
+  }
+
+  TEST(PieceTableCheck, changes_and_revert)
+  {
+    AppArmor::PieceTable table("abc {\n}\n");
+    EXPECT_TRUE(table.isOriginal());
+
+    table.replace(4, 0, "x");
+    EXPECT_FALSE(table.isOriginal());
+
+    // Undoing a change by hand should also count as having no changes
+    table.replace(4, 1, "");
+    EXPECT_TRUE(table.isOriginal());
+
+    table.replace(0, 3, "xyz");
+    EXPECT_FALSE(table.isOriginal());
+    table.revert();
+    EXPECT_TRUE(table.isOriginal());
+    EXPECT_EQ(table.operator std::string(), "abc {\n}\n");
+
+    EXPECT_THROW(table.replace(9, 0, "x"), std::out_of_range);
+    EXPECT_THROW(table.replace(4, 5, "x"), std::out_of_range);
+  }
+
+  TEST(PieceTableCheck, copies_are_independent)
+  {
+    AppArmor::PieceTable table("profile {}");
+    table.replace(9, 0, " /tmp r, ");
+
+    AppArmor::PieceTable copy = table;
+    copy.replace(9, 0, "/etc r,");
+    table.replace(0, 0, "#a\n");
+
+    EXPECT_EQ(table.operator std::string(), "#a\nprofile { /tmp r, }");
+    EXPECT_EQ(copy.operator std::string(), "profile {/etc r, /tmp r, }");
+  }
+
+  // Copies do not append to a shared buffer, so they can be changed at the same time
+  TEST(PieceTableCheck, copies_can_be_changed_on_different_threads)
+  {
+    AppArmor::PieceTable table("profile {}");
+    table.replace(9, 0, " ");
+    AppArmor::PieceTable copy = table;
+
+    auto append_rules = [](AppArmor::PieceTable &target, const std::string &rule) {
+      for(int i = 0; i < 1000; i++) {
+        target.replace(target.size() - 1, 0, rule);
+      }
+    };
+
+    std::thread other(append_rules, std::ref(copy), "/etc r, ");
+    append_rules(table, "/tmp r, ");
+    other.join();
+
+    EXPECT_EQ(table.size(), copy.size());
+    EXPECT_EQ(table.operator std::string().find("/etc"), std::string::npos);
+    EXPECT_EQ(copy.operator std::string().find("/tmp"), std::string::npos);
+  }
+
+  // Replaced text is eventually dropped, so editing the same text again and again does not keep allocating
+  TEST(PieceTableCheck, replaced_text_is_compacted)
+  {
+    AppArmor::PieceTable table("profile {}");
+    table.replace(9, 0, " /tmp r, ");
+    AppArmor::PieceTable copy = table;
+
+    for(int i = 0; i < 100000; i++) {
+      table.replace(10, 4, (i % 2 == 0) ? "/etc" : "/tmp");
+    }
+
+    EXPECT_EQ(table.operator std::string(), "profile { /tmp r, }");
+    EXPECT_LT(table.addedCapacity(), 16384);
+
+    // The copy keeps the text it shared with the table
+    EXPECT_EQ(copy.operator std::string(), "profile { /tmp r, }");
+  }
+} // namespace PieceTableCheck
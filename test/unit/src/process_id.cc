@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "parser/parser.h"
+
+namespace ProcessIdCheck {
+  std::string process(const std::string &id)
+  {
+    std::vector<char> buffer(id.size() + 1);
+    int length = processid(buffer.data(), id.data(), static_cast<int>(id.size()));
+    EXPECT_GE(length, 0) << "Failed to process: " << id;
+    return {buffer.data(), static_cast<size_t>(std::max(length, 0))};
+  }
+
+  TEST(ProcessIdCheck, find_escape_or_quote)
+  {
+    // Long enough to cover both the 16 byte blocks and the remaining characters
+    const std::string plain(40, 'a');
+    EXPECT_EQ(find_escape_or_quote(plain.data(), static_cast<int>(plain.size())), nullptr);
+
+    for(size_t i = 0; i < plain.size(); i++) {
+      for(char special : {'\\', '"'}) {
+        std::string text = plain;
+        text[i] = special;
+        text[text.size() - 1] = special;
+        EXPECT_EQ(find_escape_or_quote(text.data(), static_cast<int>(text.size())), text.data() + i);
+      }
+    }
+
+    // Characters past 'len' should be ignored
+    const std::string text = "abc\\";
+    EXPECT_EQ(find_escape_or_quote(text.data(), 3), nullptr);
+  }
+
+  TEST(ProcessIdCheck, escape_sequences)
+  {
+    EXPECT_EQ(process("/usr/lib/**"), "/usr/lib/**");
+    EXPECT_EQ(process("/usr/share/some-very-long-directory-name/file"), "/usr/share/some-very-long-directory-name/file");
+    EXPECT_EQ(process("\"/home/user/My Documents/\""), "/home/user/My Documents/");
+    EXPECT_EQ(process("/usr/share/some-very-long-directory\\040name"), "/usr/share/some-very-long-directory name");
+    EXPECT_EQ(process("/path/with\\\\backslash"), "/path/with\\\\backslash");
+  }
+} // namespace ProcessIdCheck
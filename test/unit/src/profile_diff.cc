@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "apparmor_parser.hh"
+
+namespace ProfileDiffCheck {
+  const std::string filename = ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test3_remove.sd";
+
+  TEST(ProfileDiffCheck, unchanged)
+  {
+    AppArmor::Parser parser(filename);
+    AppArmor::Parser other(filename);
+    EXPECT_TRUE(parser.diff(parser).empty());
+    EXPECT_TRUE(parser.diff(other).empty());
+
+    // Whitespace is not part of a rule
+    std::string text = other.operator std::string();
+    text.replace(text.find("rrr,"), 4, "rrr ,\n\n");
+    other.updateFromString(text);
+    EXPECT_TRUE(parser.diff(other).empty());
+  }
+
+  TEST(ProfileDiffCheck, rule_changes)
+  {
+    AppArmor::Parser parser(filename);
+    AppArmor::Parser changed = parser;
+
+    auto front = changed.getProfileList().front();
+    auto removed = front.getFileRules().front();
+    changed.removeRule(front, removed);
+
+    auto back = changed.getProfileList().back();
+    auto edited = back.getFileRules().front();
+    changed.editRule(back, edited, AppArmor::FileRule("/usr/X11R6/lib/lib*so*", "rw"));
+
+    back = changed.getProfileList().back();
+    changed.addRule(back, AppArmor::FileRule("/added", "rw"));
+
+    auto changes = parser.diff(changed);
+    ASSERT_EQ(changes.size(), 2);
+
+    EXPECT_EQ(changes[0].change, AppArmor::ChangeKind::Modified);
+    EXPECT_EQ(changes[0].name, front.name());
+    ASSERT_EQ(changes[0].rules.size(), 1);
+    EXPECT_EQ(changes[0].rules[0].change, AppArmor::ChangeKind::Removed);
+    EXPECT_EQ(changes[0].rules[0].kind, AppArmor::Tree::RuleKind::File);
+    EXPECT_EQ(*changes[0].rules[0].before, removed);
+    EXPECT_EQ(changes[0].rules[0].after, nullptr);
+
+    // The edited rule is matched with the old one, and the new rule is added after it
+    EXPECT_EQ(changes[1].name, back.name());
+    ASSERT_EQ(changes[1].rules.size(), 2);
+    EXPECT_EQ(changes[1].rules[0].change, AppArmor::ChangeKind::Modified);
+    EXPECT_EQ(*changes[1].rules[0].before, edited);
+    EXPECT_EQ(*changes[1].rules[0].after, back.getFileRules().front());
+    EXPECT_EQ(changes[1].rules[1].change, AppArmor::ChangeKind::Added);
+    EXPECT_EQ(*changes[1].rules[1].after, back.getFileRules().back());
+  }
+
+  TEST(ProfileDiffCheck, profile_changes)
+  {
+    AppArmor::Parser parser(filename);
+    AppArmor::Parser renamed = parser;
+
+    std::string text = renamed.operator std::string();
+    text.replace(text.find("/* {"), 1, "/renamed");
+    renamed.updateFromString(text);
+
+    // Profiles are matched by name, so a renamed profile is removed and added again
+    auto changes = parser.diff(renamed);
+    ASSERT_EQ(changes.size(), 2);
+    EXPECT_EQ(changes[0].change, AppArmor::ChangeKind::Removed);
+    EXPECT_EQ(changes[0].name, "/*");
+    EXPECT_EQ(changes[1].change, AppArmor::ChangeKind::Added);
+    EXPECT_EQ(changes[1].name, "/renamed*");
+    EXPECT_EQ(changes[1].after, &renamed.getProfileList().back());
+  }
+} // namespace ProfileDiffCheck
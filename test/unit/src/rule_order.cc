@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "apparmor_parser.hh"
+#include "tree/GenericRule.hh"
+#include "tree/ProfileRule.hh"
+
+namespace RuleOrderCheck {
+  using AppArmor::Tree::GenericRule;
+
+  // Names each kind of rule, so the order can be compared as a list of strings
+  struct RuleNamer {
+    std::vector<std::string> &names;
+
+    void operator()(const AppArmor::Tree::FileRule &rule) { names.push_back("file " + rule.getFilename()); }
+    void operator()(const AppArmor::Tree::LinkRule &) { names.emplace_back("link"); }
+    void operator()(const AppArmor::Tree::RuleList &) { names.emplace_back("block"); }
+    void operator()(const AppArmor::Tree::AbstractionRule &rule) { names.push_back("include " + rule.getPath()); }
+    void operator()(const AppArmor::Tree::ProfileRule &rule) { names.push_back("profile " + rule.name()); }
+    void operator()(const AppArmor::Tree::AllRule &) { names.emplace_back("all"); }
+    void operator()(const GenericRule &rule) { names.emplace_back(GenericRule::getKindName(rule.getKind())); }
+  };
+
+  TEST(RuleOrderCheck, rules_are_kept_in_source_order)
+  {
+    AppArmor::Parser parser(ADDITIONAL_PROFILE_SOURCE_DIR "/rule-order/mixed_rules.sd");
+    ASSERT_EQ(parser.getProfileList().size(), 1);
+    const auto &profile = parser.getProfileList().front();
+
+    std::vector<std::string> names;
+    profile.visit(RuleNamer{names});
+
+    const std::vector<std::string> expected = {
+      "include abstractions/base",
+      "capability",
+      "file /etc/passwd",
+      "network",
+      "profile hat",
+      "link",
+      "signal",
+      "ptrace",
+      "file /var/log/**",
+      "profile sub",
+      "mount"
+    };
+    EXPECT_EQ(names, expected);
+
+    EXPECT_EQ(profile.getHats().size(), 1);
+    EXPECT_EQ(profile.getSubprofiles().size(), 1);
+    EXPECT_EQ(profile.getGenericRules().size(), 5);
+    EXPECT_TRUE(profile.getGenericRules().back().getPrefix().getShouldDeny());
+  }
+
+  TEST(RuleOrderCheck, generic_rules_can_be_removed)
+  {
+    AppArmor::Parser parser(ADDITIONAL_PROFILE_SOURCE_DIR "/rule-order/mixed_rules.sd");
+    auto profile = parser.getProfileList().front();
+    auto network = profile.getGenericRules().at(1);
+    ASSERT_EQ(network.getKind(), GenericRule::Kind::Network);
+
+    std::string contents = parser.operator std::string();
+    EXPECT_EQ(contents.substr(network.getStartPosition(), network.getEndPosition() - network.getStartPosition()), "network inet stream,");
+
+    parser.removeRule(profile, network);
+    EXPECT_EQ(parser.getProfileList().front().getGenericRules().size(), 4);
+    EXPECT_EQ(parser.operator std::string().find("network"), std::string::npos);
+  }
+
+  // A rule's prefix is part of the rule, so removing the rule does not leave the prefix for the next rule
+  TEST(RuleOrderCheck, prefixed_rules_are_removed_with_their_prefix)
+  {
+    AppArmor::Parser parser(ADDITIONAL_PROFILE_SOURCE_DIR "/rule-order/prefixed_rules.sd");
+    auto profile = parser.getProfileList().front();
+    auto network = profile.getGenericRules().front();
+    ASSERT_EQ(network.getKind(), GenericRule::Kind::Network);
+    EXPECT_TRUE(network.getPrefix().getShouldDeny());
+
+    std::string contents = parser.operator std::string();
+    EXPECT_EQ(contents.substr(network.getStartPosition(), network.getEndPosition() - network.getStartPosition()), "deny network raw,");
+
+    // A prefix without 'audit' starts at its first flag, rather than after the previous rule
+    const auto &file = profile.getFileRules().front();
+    EXPECT_TRUE(file.getPrefix().getOwner());
+    EXPECT_EQ(contents.substr(file.getStartPosition(), file.getEndPosition() - file.getStartPosition()), "owner /etc/shadow r,");
+
+    parser.removeRule(profile, network);
+    profile = parser.getProfileList().front();
+    ASSERT_EQ(profile.getFileRules().size(), 1);
+    EXPECT_FALSE(profile.getFileRules().front().getPrefix().getShouldDeny());
+    EXPECT_EQ(parser.operator std::string().find("deny network"), std::string::npos);
+    EXPECT_NE(parser.operator std::string().find("# Kept when the rules around it are removed"), std::string::npos);
+
+    // A rule with several prefixes is removed as a whole
+    auto capability = profile.getGenericRules().front();
+    parser.removeRule(profile, capability);
+    EXPECT_EQ(parser.operator std::string().find("deny"), std::string::npos);
+  }
+} // namespace RuleOrderCheck
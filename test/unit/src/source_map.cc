@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "apparmor_parser.hh"
+#include "source_map.hh"
+
+namespace SourceMapCheck {
+  TEST(SourceMapCheck, locations_without_parser)
+  {
+    const std::string text = "ab\ncd\n\nef";
+
+    AppArmor::SourceMap map;
+    map.addLineBreaks(text.data(), 4, 0);
+    map.addLineBreaks(text.data() + 4, text.size() - 4, 4);
+
+    ASSERT_EQ(map.getLineCount(), 4);
+    EXPECT_EQ(map.getLocation(0), AppArmor::SourceMap::Location({1, 1}));
+    EXPECT_EQ(map.getLocation(1), AppArmor::SourceMap::Location({1, 2}));
+    EXPECT_EQ(map.getLocation(3), AppArmor::SourceMap::Location({2, 1}));
+    EXPECT_EQ(map.getLocation(6), AppArmor::SourceMap::Location({3, 1}));
+    EXPECT_EQ(map.getLocation(8), AppArmor::SourceMap::Location({4, 2}));
+    EXPECT_EQ(map.getLineStart(4), 7);
+    EXPECT_ANY_THROW(map.getLineStart(5));
+  }
+
+  TEST(SourceMapCheck, replace_text)
+  {
+    const std::string before = "ab\ncd\n\nef\ngh\n";
+    const std::string after  = "ab\ncX\nY\nZ\nef\ngh\n";
+
+    // Replace "d\n\n" (at position 4) with "X\nY\nZ\n"
+    AppArmor::SourceMap map;
+    map.addLineBreaks(before.data(), before.size(), 0);
+    map.replaceText(4, 3, "X\nY\nZ\n");
+
+    AppArmor::SourceMap expected;
+    expected.addLineBreaks(after.data(), after.size(), 0);
+
+    ASSERT_EQ(map.getLineCount(), expected.getLineCount());
+    for(uint64_t line = 1; line <= expected.getLineCount(); line++) {
+      EXPECT_EQ(map.getLineStart(line), expected.getLineStart(line)) << "line " << line;
+    }
+
+    // Erasing text should also remove its line breaks
+    map.replaceText(4, 6, "");
+    AppArmor::SourceMap erased;
+    const std::string erased_text = "ab\ncef\ngh\n";
+    erased.addLineBreaks(erased_text.data(), erased_text.size(), 0);
+
+    ASSERT_EQ(map.getLineCount(), erased.getLineCount());
+    for(uint64_t line = 1; line <= erased.getLineCount(); line++) {
+      EXPECT_EQ(map.getLineStart(line), erased.getLineStart(line)) << "line " << line;
+    }
+  }
+
+  TEST(SourceMapCheck, file_rule_locations)
+  {
+    auto filename = ADDITIONAL_PROFILE_SOURCE_DIR "/remove-untouched/test2_remove.sd";
+
+    AppArmor::Parser parser(filename);
+    auto profile_list = parser.getProfileList();
+    ASSERT_EQ(profile_list.size(), 1) << "There should be one profile";
+
+    auto file_rules = profile_list.front().getFileRules();
+    ASSERT_EQ(file_rules.size(), 3) << "There should be three file rules";
+
+    const auto &map = parser.getSourceMap();
+    uint64_t line = 10;
+    for(const auto &rule : file_rules) {
+      EXPECT_EQ(map.getLocation(rule.getStartPosition()), AppArmor::SourceMap::Location({line, 3}));
+      line++;
+    }
+
+    // The positions should point at the text of each rule
+    std::string contents = parser.operator std::string();
+    const auto &first = file_rules.front();
+    EXPECT_EQ(contents.substr(first.getStartPosition(), first.getEndPosition() - first.getStartPosition()),
+              "/usr/X11R6/lib/lib*so* rrr,");
+  }
+} // namespace SourceMapCheck
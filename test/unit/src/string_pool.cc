@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "parser/string_pool.hh"
+
+namespace StringPoolCheck {
+  TEST(StringPoolCheck, equal_strings_share_storage)
+  {
+    StringPool pool;
+
+    std::string first  = "/usr/lib/**";
+    std::string second = "/usr/lib/**";
+
+    auto first_view  = pool.intern(first);
+    auto second_view = pool.intern(second);
+
+    EXPECT_EQ(first_view, "/usr/lib/**");
+    EXPECT_EQ(first_view.data(), second_view.data()) << "Equal strings should be interned once";
+    EXPECT_NE(first_view.data(), first.data()) << "The pool should keep its own copy";
+    EXPECT_EQ(pool.size(), 1);
+
+    EXPECT_NE(pool.intern("@{HOME}").data(), first_view.data());
+    EXPECT_EQ(pool.size(), 2);
+  }
+
+  TEST(StringPoolCheck, views_stay_valid)
+  {
+    StringPool pool;
+
+    // Enough strings to fill several chunks, plus one that is larger than a chunk
+    std::vector<std::string> strings;
+    for(int i = 0; i < 5000; i++) {
+      strings.push_back("/path/to/file" + std::to_string(i));
+    }
+    strings.push_back(std::string(100000, 'a'));
+
+    std::vector<std::string_view> views;
+    for(const auto &str : strings) {
+      views.push_back(pool.intern(str));
+    }
+
+    ASSERT_EQ(pool.size(), strings.size());
+    for(size_t i = 0; i < strings.size(); i++) {
+      EXPECT_EQ(views[i], strings[i]);
+    }
+  }
+} // namespace StringPoolCheck